@@ -1,3 +1,4 @@
+#pragma once
 
 // (C) Copyright Tobias Schwinger
 //
@@ -29,7 +30,20 @@
 */
 
 #include <vector>
+#include <map>
 #include <string>
+#include <sstream>
+#include <climits>
+#include <typeinfo>
+#include <iterator>
+#include <memory>
+#include <tuple>
+#include <utility>
+#include <type_traits>
+#include <mutex>
+#include <atomic>
+#include <future>
+#include <exception>
 #include <stdexcept>
 #include <unordered_map>
 
@@ -39,90 +53,478 @@
 #include <boost/token_functions.hpp>
 
 #include <boost/lexical_cast.hpp>
-#include <boost/function.hpp>
-#include <boost/bind.hpp>
+#include <boost/utility/enable_if.hpp>
 
-#include <boost/fusion/include/push_back.hpp>
-#include <boost/fusion/include/cons.hpp>
-#include <boost/fusion/include/invoke.hpp>
-
-#include <boost/mpl/begin.hpp>
-#include <boost/mpl/end.hpp>
-#include <boost/mpl/next.hpp>
-#include <boost/mpl/deref.hpp>
+#include <boost/fusion/include/tuple.hpp>
 
 #include <boost/type_traits/remove_cv.hpp>
 #include <boost/type_traits/remove_reference.hpp>
 
-#include <boost/function_types/is_nonmember_callable_builtin.hpp>
-#include <boost/function_types/parameter_types.hpp>
-#include <boost/function_types/result_type.hpp>
+#include "call_metrics.hpp"
+#include "callable_traits.hpp"
+#include "inline_function.hpp"
+#include "memo_cache.hpp"
+#include "name_hash.hpp"
+#include "parse_arena.hpp"
+#include "pipeline.hpp"
+#include "reader_epoch.hpp"
+#include "small_any.hpp"
+#include "symbol_table.hpp"
+#include "token_cast.hpp"
+#include "token_stream.hpp"
+#include "work_stealing_pool.hpp"
+
+#ifdef __cpp_lib_string_view
+#include "token_view.hpp"
+#endif
 
 namespace DT
 {
   namespace fusion = boost::fusion;
-	namespace ft = boost::function_types;
-	namespace mpl = boost::mpl;
+#ifdef _MSC_VER
 	using namespace std::tr1;
+#endif
 	using namespace std;
 
 	template< typename tokenIter= typename boost::token_iterator_generator< boost::char_separator<char> >::type > 
 	class interpreter_param_parser;
-	
+
+	/**
+	* Create the param parser R from the input T. interpreter::make_param_parser() forwards to it,
+	* specialize it to support the new input type.
+	*/
+	template<typename T, typename R>
+	struct param_parser_factory;
+
+	/**
+	* The return types which are waited for. A registered function returning one of them is an
+	* asynchronous function, async_parse_input() keeps it pending and goes on to the next command.
+	* Specialize it for the other future types, they need get() to wait for the value.
+	*/
+	template<typename R>
+	struct is_async_result : std::false_type
+	{ };
+
+	template<typename R>
+	struct is_async_result< std::future<R> > : std::true_type
+	{ };
+
+	template<typename R>
+	struct is_async_result< std::shared_future<R> > : std::true_type
+	{ };
+
+	/**
+	* The flag of register_function() for a pure function, its result depends on the arguments
+	* only. The results are cached by the converted arguments, a repeated call takes the cached
+	* result instead of calling the function. The parameter types need std::hash and operator==.
+	*/
+	struct pure_function
+	{
+		/** the max count of the cached results */
+		size_t capacity;
+
+		explicit pure_function(size_t nCapacity = 1024) : capacity(nCapacity)
+		{ }
+	};
+
+	/** the default capacity of interpreter::EnableParseCache() in input texts */
+	const size_t parse_cache_capacity = 1024;
+
+	/** the error kinds of the non-throwing calls, TryExecInvoker() and try_parse_input() */
+	enum invoker_errc
+	{
+		invoker_ok = 0,
+		invoker_unknown_function,
+		invoker_invalid_argument,
+		invoker_result_mismatch,
+		invoker_argument_mismatch
+	};
+
+	struct invoker_error
+	{
+		invoker_errc code;
+		size_t fnID;
+
+		/** the zero based index of the bad argument, the object of a member function isn't counted */
+		size_t arg_index;
+
+		std::string message() const
+		{
+			stringstream strStream;
+
+			if(code == invoker_unknown_function)
+				strStream << "unknown function (ID:" << std::showbase << std::uppercase << std::hex << fnID << ")";
+			else if(code == invoker_invalid_argument)
+				strStream << "invalid argument " << arg_index << " of the function (ID:" << std::showbase << std::uppercase << std::hex << fnID << ")";
+			else if(code == invoker_result_mismatch)
+				strStream << "the function (ID:" << std::showbase << std::uppercase << std::hex << fnID << ") returns another type";
+			else if(code == invoker_argument_mismatch)
+				strStream << "the column " << arg_index << " isn't the parameter type of the function (ID:" << std::showbase << std::uppercase << std::hex << fnID << ")";
+
+			return strStream.str();
+		}
+	};
+
+	/**
+	* The result of a non-throwing call, either the returned value or the error. value() throws
+	* the error as std::runtime_error, it is how the throwing API is built on the non-throwing one.
+	*/
+	template<typename T>
+	class invoker_result
+	{
+	public:
+		invoker_result() : m_value()
+		{
+			m_error.code = invoker_ok;
+			m_error.fnID = 0;
+			m_error.arg_index = 0;
+		}
+
+		explicit invoker_result(T value) : m_value(std::move(value))
+		{
+			m_error.code = invoker_ok;
+			m_error.fnID = 0;
+			m_error.arg_index = 0;
+		}
+
+		static inline invoker_result failure(invoker_error const& err)
+		{
+			invoker_result result;
+			result.m_error = err;
+			return result;
+		}
+
+		inline bool has_value() const
+		{
+			return m_error.code == invoker_ok;
+		}
+
+		inline explicit operator bool() const
+		{
+			return has_value();
+		}
+
+		inline T& value()
+		{
+			if(!has_value())
+				throw std::runtime_error(m_error.message());
+
+			return m_value;
+		}
+
+		inline T const& value() const
+		{
+			if(!has_value())
+				throw std::runtime_error(m_error.message());
+
+			return m_value;
+		}
+
+		inline T value_or(T const& defValue) const
+		{
+			return has_value() ? m_value : defValue;
+		}
+
+		inline invoker_error const& error() const
+		{
+			return m_error;
+		}
+
+	protected:
+		T m_value;
+		invoker_error m_error;
+	};
+
+	namespace detail
+	{
+		// the value an asynchronous result gives, the result itself for the others
+		template<typename R, bool bAsync = is_async_result<typename std::decay<R>::type>::value>
+		struct result_value
+		{
+			typedef typename std::decay<R>::type type;
+		};
+
+		template<typename R>
+		struct result_value<R, true>
+		{
+			typedef typename std::decay<decltype(std::declval<typename std::decay<R>::type&>().get())>::type type;
+		};
+
+		template<bool... Values>
+		struct any_of : std::false_type
+		{ };
+
+		template<bool First, bool... Rest>
+		struct any_of<First, Rest...> : std::integral_constant<bool, First || any_of<Rest...>::value>
+		{ };
+
+		// the cache key of an argument owns its value, a view into the input is copied to a string
+		template<typename T>
+		struct memo_key
+		{
+			typedef typename std::decay<T>::type type;
+		};
+
+#ifdef __cpp_lib_string_view
+		template<typename Char, typename Traits>
+		struct memo_key< std::basic_string_view<Char,Traits> >
+		{
+			typedef std::basic_string<Char,Traits> type;
+		};
+#endif
+
+		// take the non-throwing try_get() of the parser if it has one, otherwise the get()
+		template<typename T, typename Parser>
+		inline auto parser_try_get(Parser & parser, bool & bOk, int) -> decltype(parser.template try_get<T>(bOk))
+		{
+			return parser.template try_get<T>(bOk);
+		}
+
+		template<typename T, typename Parser>
+		inline auto parser_try_get(Parser & parser, bool & bOk, long) -> decltype(parser.template get<T>())
+		{
+			bOk = true;
+			return parser.template get<T>();
+		}
+	}
+
+	/**
+	* The function IDs are the name_hash of the names, so they match DT_FUNCTION_ID. Before it they
+	* were the std::hash<std::string> of the names: an ID or a DISPID saved by an earlier build
+	* doesn't find its function any more, pass std::hash<std::string> as the Hasher to keep them.
+	*/
 	template<typename paramparser=interpreter_param_parser<boost::token_iterator_generator< boost::char_separator<char> >::type>, 
-		typename InvokerR = boost::any
-		,typename Hasher = std::hash<std::string> >
+		typename InvokerR = small_any
+		,typename Hasher = name_hash >
 	class interpreter
 	{
-		typedef boost::function<InvokerR (paramparser &)> invoker_function;
-		typedef pair<std::string, invoker_function> invoker_info;
+	protected:
+		/** the result of an asynchronous function which isn't waited for yet */
+		struct pending_call
+		{
+			virtual ~pending_call()
+			{ }
+
+			/** wait for the result, it rethrows the exception of the function */
+			virtual InvokerR get() = 0;
+		};
+
+	private:
+		/**
+		* The non-throwing invoker entry, a bad argument is reported by the invoker_error. If
+		* ppCall isn't NULL, an asynchronous function hands out its pending call there instead of
+		* being waited for.
+		*/
+		typedef inline_function<bool (paramparser &, InvokerR &, pending_call **, invoker_error &)> invoker_function;
+
+		/**
+		* The typed invoker entry of ExecInvoker<R>(). The result is written to pResult directly if
+		* the function returns the type, otherwise it fails with invoker_result_mismatch.
+		*/
+		typedef inline_function<bool (paramparser &, void *, std::type_info const &, invoker_error &)> typed_invoker_function;
+
+		/** the columns and the output of ApplyBatch(), the types are checked by the batch entry */
+		struct batch_args
+		{
+			void const* const* ppColumns;
+			std::type_info const* const* ppTypes;
+			size_t nColumns;
+			size_t nRows;
+			void* pOut;
+			std::type_info const* pOutType;
+		};
+
+		typedef inline_function<bool (batch_args const &, invoker_error &)> batch_invoker_function;
+
+	protected:
+		/** one command of a compiled program, its arguments are converted already */
+		struct compiled_command
+		{
+			/** parallel execute() may run it together with the neighbouring independent commands */
+			bool independent;
+
+			/** the symbol of the function name, for the call metrics */
+			symbol_id symbol;
+
+			compiled_command() : independent(false), symbol(no_symbol)
+			{ }
+
+			virtual ~compiled_command()
+			{ }
+
+			virtual InvokerR call() const = 0;
+		};
+
+	private:
+		typedef inline_function<compiled_command* (paramparser &)> compiler_function;
+
+		/** the result cache of a pure function, a replaced one is retired with the snapshots */
+		struct memo_base
+		{
+			virtual ~memo_base()
+			{ }
+
+			virtual memo_stats stats() = 0;
+		};
+
+		struct invoker_info
+		{
+			/** the interned name, it is shared by the snapshots instead of being copied */
+			std::string const* pName;
+			symbol_id symbol;
+			invoker_function invoke;
+			typed_invoker_function invoke_typed;
+			batch_invoker_function apply_batch;
+			compiler_function compile;
+			bool independent;
+
+			/** the result cache of a pure function, NULL for the others */
+			memo_base* pMemo;
+
+			invoker_info() : pName(NULL), symbol(no_symbol), independent(false), pMemo(NULL) { }
+		};
+
 		typedef unordered_map<size_t,invoker_info> dictionary;
 		
 	protected:
+		/**
+		* The frozen dispatch table built by freeze(). It is a flat open-addressing table, the
+		* home slot of an ID is (ID * frozen_seed) >> frozen_shift. freeze() searches the seed and
+		* the table size to make every ID land in its own slot, then a dispatch is a single probe.
+		*/
+		struct frozen_slot
+		{
+			size_t id;
+			invoker_info info;
+
+			frozen_slot() : id(0) { }
+		};
+
+		struct parse_cache;
+
+		/**
+		* The registry the dispatch reads. It is an immutable snapshot of map_invokers, so any
+		* number of threads can dispatch without a lock. The writers change map_invokers under
+		* registry_lock and drop the published snapshot, the next dispatch publishes a new one.
+		* A replaced snapshot may still be read by another thread, it is retired and freed once
+		* no reader_scope can see it, see reader_epoch.hpp.
+		*/
+		struct registry
+		{
+			dictionary map_invokers;
+
+			/** the interned names by symbol, for the lookup without registry_lock */
+			std::vector<std::string const*> symbol_names;
+
+			std::vector<frozen_slot> frozen_table;
+			size_t frozen_seed;
+			size_t frozen_shift;
+
+			/** the max probe count of the frozen table. 0 means the table isn't frozen */
+			size_t frozen_probes;
+
+			/** the parse cache of try_parse_input(), NULL if it isn't enabled */
+			parse_cache* pParseCache;
+
+			/** the buffer size of the parse arena of try_parse_input(), 0 if it isn't enabled */
+			size_t nArenaBytes;
+
+			/** the count of the snapshots built before, a freed snapshot's address may be reused */
+			size_t generation;
+
+			registry() : frozen_seed(0), frozen_shift(0), frozen_probes(0), pParseCache(NULL), nArenaBytes(0), generation(0) { }
+		};
+
+		/** a replaced snapshot, parse cache or memo, tagged with the epoch it was retired in */
+		struct retired_object
+		{
+			size_t epoch;
+			std::shared_ptr<void const> object;
+		};
+
 		dictionary map_invokers;
+		symbol_table<std::string, Hasher> symbols;
 		Hasher hash_fn;
 
-	public:
-		typedef interpreter_param_parser< boost::token_iterator_generator< boost::char_separator<char> >::type > _string_param_parser;
-		typedef interpreter_param_parser< boost::token_iterator_generator< boost::char_separator<wchar_t> >::type > _wstring_param_parser;
-		
-		template<typename T, typename R> static inline R make_param_parser(T const & args);
+		/** freeze() is requested, the published snapshot gets the frozen table */
+		bool bFreeze;
 
-		template<> inline static _wstring_param_parser make_param_parser<std::wstring,_wstring_param_parser>(std::wstring const& text)
-		{
-			boost::char_separator<std::wstring::traits_type> s(L" \t\n\r");
+		mutable std::mutex registry_lock;
+		std::atomic<registry const*> published;
 
-			return _wstring_param_parser(boost::make_token_iterator<std::wstring>(text.begin(), text.end(), s),
-				boost::make_token_iterator<std::wstring>(text.end()  , text.end(), s));
-		}	
+		/** the snapshot built last, it is retired when the next one is built */
+		std::shared_ptr<registry const> pLatest;
+		size_t nGenerations;
+
+		/** the replaced snapshots, parse caches and memos which a reader may still see */
+		std::vector<retired_object> retired;
+
+		/** the caches of the pure functions, a replaced one is retired */
+		std::vector< std::unique_ptr<memo_base> > memos;
+
+		/** the registered pipelines by the function ID, their pipeline_ref handles refer to them */
+		std::unordered_map< size_t, std::shared_ptr<void const> > pipelines;
+
+		/** the enabled parse cache, a replaced one is retired */
+		std::unique_ptr<parse_cache> pParseCache;
+
+		/** the buffer size of the parse arena, 0 if it isn't enabled */
+		size_t nArenaBytes;
+
+#ifdef DT_INTERPRETER_METRICS
+		/** the call metrics by the symbol of the function name */
+		call_metrics metrics;
+#endif
 
-		template<> inline static _string_param_parser make_param_parser<std::string,_string_param_parser>(std::string const& text)
+	public:
+		/** two different names were registered with the same function ID */
+		struct invoker_collision
 		{
-			boost::char_separator<char> s(" \t\n\r");
+			size_t id;
+			std::string registered_name;
+			std::string new_name;
+		};
 
-			return _string_param_parser(boost::make_token_iterator<std::string>(text.begin(), text.end(), s),
-				boost::make_token_iterator<std::string>(text.end()  , text.end(), s));
-		}	
+	protected:
+		std::vector<invoker_collision> id_collisions;
+
+	public:
+		interpreter()
+			: bFreeze(false), published(NULL), nGenerations(0), nArenaBytes(0)
+		{ }
+
+		typedef interpreter_param_parser< boost::token_iterator_generator< boost::char_separator<char> >::type > _string_param_parser;
+		typedef interpreter_param_parser< boost::token_iterator_generator< boost::char_separator<wchar_t>, std::wstring::const_iterator, std::wstring >::type > _wstring_param_parser;
+
+		// the streaming parsers, parse_input(token_stream) reads an istream or a mapped_file by chunks
+		typedef interpreter_param_parser< token_stream_iterator<char> > _stream_param_parser;
+		typedef interpreter_param_parser< token_stream_iterator<wchar_t> > _wstream_param_parser;
+
+#ifdef __cpp_lib_string_view
+		// the zero-copy parsers, the tokens are views into the input text
+		typedef interpreter_param_parser< token_view_iterator<char> > _string_view_param_parser;
+		typedef interpreter_param_parser< token_view_iterator<wchar_t> > _wstring_view_param_parser;
+#endif
+		
+		template<typename T, typename R> static inline R make_param_parser(T const & args)
+		{
+			return param_parser_factory<T,R>::make(args);
+		}
 
 		// Registers a function with the interpreter.
 		template<typename Function>
-		typename boost::enable_if< ft::is_nonmember_callable_builtin<Function>, size_t
+		typename boost::enable_if_c< callable_traits<Function>::is_function && !callable_traits<Function>::is_member, size_t
 		>::type register_function(std::string const & name, Function f)
 		{
-			size_t fnID = hash_fn(name);
-			map_invokers[fnID] = invoker_info(name,	boost::bind(&invoker<Function>::apply<fusion::nil>, f,_1,fusion::nil() ));
-
-			return fnID;
+			return add_invoker(hash_fn(name), name, function_binder<Function>(f));
 		}
 
 		// Registers a function with the interpreter.
 		template<typename Function>
-		typename boost::enable_if< ft::is_nonmember_callable_builtin<Function>, size_t
+		typename boost::enable_if_c< callable_traits<Function>::is_function && !callable_traits<Function>::is_member, size_t
 		>::type register_function(size_t fnID,std::string const & name, Function f)
 		{
-			map_invokers[fnID] = invoker_info(name,	boost::bind(&invoker<Function>::apply<fusion::nil>, f,_1,fusion::nil() ));
-
-			return fnID;
+			return add_invoker(fnID, name, function_binder<Function>(f));
 		}
 
 		/**
@@ -131,130 +533,1523 @@ namespace DT
 		// Registers a member function with the interpreter. 
 		// Will not compile if it's a non-member function.
 		template<typename Function, typename TheClass>
-		typename boost::enable_if< ft::is_member_function_pointer<Function>, size_t >::type 
+		typename boost::enable_if_c< callable_traits<Function>::is_member, size_t >::type 
 			register_function(std::string const& name, Function f, TheClass* theclass)
 		{   
-			size_t fnID = hash_fn(name);
-			
-			map_invokers[fnID] = invoker_info(name,	boost::bind(&invoker<Function>::apply<fusion::nil,TheClass>,f,theclass,_1,fusion::nil()));
-
-			return fnID;
+			return add_invoker(hash_fn(name), name, member_function_binder<Function,TheClass>(f, theclass));
 		}
 
 		// Registers a member function with the interpreter. 
 		// Will not compile if it's a non-member function.
 		template<typename Function, typename TheClass>
-		typename boost::enable_if< ft::is_member_function_pointer<Function>, size_t >::type 
+		typename boost::enable_if_c< callable_traits<Function>::is_member, size_t >::type 
 			register_function(size_t fnID,std::string const& name, Function f, TheClass* theclass)
 		{   
-			map_invokers[fnID] = invoker_info(name,	boost::bind(&invoker<Function>::apply<fusion::nil,TheClass>,f,theclass,_1,fusion::nil()));
-
-			return fnID;
+			return add_invoker(fnID, name, member_function_binder<Function,TheClass>(f, theclass));
 		}
 
 		/**
-		* Return the specified function ID. 
-		* 
-		* \param name		the method name
-		* \param bVerify	true means need verify ID whether it exists in the invoker list. false means
-							just generate ID based on the name
-
-		* \return 0 means the specified function isn't registered.
+		* Register the pipeline of the stages as one function, see pipeline.hpp. It takes the 
+		* parameters of the stages in order except the piped ones and returns the result of the 
+		* last stage. A stage whose result isn't the first parameter type of the next stage is a
+		* compile error.
 		*/
-		inline size_t GetInvokerID(std::string const & name, bool bVerify = true)
+		template<typename... Stages>
+		inline size_t register_pipeline(std::string const & name, Stages... stages)
 		{
-			size_t fnID = hash_fn(name);
-			 
-			if(bVerify && map_invokers.count(fnID) == 0)
-				fnID = 0;
+			return register_pipeline(hash_fn(name), name, stages...);
+		}
 
-			return fnID;
+		template<typename... Stages>
+		size_t register_pipeline(size_t fnID, std::string const & name, Stages... stages)
+		{
+			pipeline_function<Stages...>* pPipeline = new pipeline_function<Stages...>(stages...);
+			std::shared_ptr<void const> pOwner(pPipeline);
+			pipeline_ref<Stages...> ref = {pPipeline};
+
+			return add_invoker(fnID, name, function_binder< pipeline_ref<Stages...> >(ref), NULL, std::move(pOwner));
 		}
 
-		inline bool IsRegisteredID(size_t ID)
+		/**
+		* Register the functions of a function_table, the IDs are the ones computed at compile time.
+		* The IDs are the function IDs only if Hasher is name_hash.
+		*/
+		template<typename... Functions>
+		void register_table(function_table<Functions...> const & table)
+		{
+			register_entries(table, static_cast<void*>(NULL), std::index_sequence_for<Functions...>());
+		}
+
+		/** register the member functions of the table with the object */
+		template<typename TheClass, typename... Functions>
+		void register_table(function_table<Functions...> const & table, TheClass* theclass)
 		{
-			return (map_invokers.count(ID) > 0);
+			register_entries(table, theclass, std::index_sequence_for<Functions...>());
 		}
 
-		inline std::string GetInvokerName(size_t ID)
+		/** register a pure function, its results are cached (see pure_function and GetMemoStats()) */
+		template<typename Function>
+		typename boost::enable_if_c< callable_traits<Function>::is_function && !callable_traits<Function>::is_member, size_t
+		>::type register_function(std::string const & name, Function f, pure_function const & pure)
 		{
-			std::string strName;
+			return add_pure_invoker(hash_fn(name), name, function_binder<Function>(f), pure);
+		}
 
-			if(map_invokers.count(ID) > 0)
-				strName = map_invokers[ID].first;
+		template<typename Function>
+		typename boost::enable_if_c< callable_traits<Function>::is_function && !callable_traits<Function>::is_member, size_t
+		>::type register_function(size_t fnID, std::string const & name, Function f, pure_function const & pure)
+		{
+			return add_pure_invoker(fnID, name, function_binder<Function>(f), pure);
+		}
 
-			return strName;
+		template<typename Function, typename TheClass>
+		typename boost::enable_if_c< callable_traits<Function>::is_member, size_t >::type 
+			register_function(std::string const& name, Function f, TheClass* theclass, pure_function const & pure)
+		{
+			return add_pure_invoker(hash_fn(name), name, member_function_binder<Function,TheClass>(f, theclass), pure);
 		}
 
-		inline InvokerR ExecInvoker(size_t fnID, paramparser& args)
+		template<typename Function, typename TheClass>
+		typename boost::enable_if_c< callable_traits<Function>::is_member, size_t >::type 
+			register_function(size_t fnID, std::string const& name, Function f, TheClass* theclass, pure_function const & pure)
 		{
-			InvokerR retVal;
+			return add_pure_invoker(fnID, name, member_function_binder<Function,TheClass>(f, theclass), pure);
+		}
 
-			if(map_invokers.count(fnID) > 0)
-				retVal = map_invokers[fnID].second(args);
-			else
+		/**
+		* Freeze the registered functions into a flat dispatch table. The names and the invokers are
+		* stored contiguously in the table, so ExecInvoker() can find a function with one probe
+		* instead of walking the dictionary buckets. Registering another function drops the frozen
+		* table, call freeze() again after the registration is done.
+		*
+		* \throw std::runtime_error if two different names got the same function ID. The later one
+		*		overwrote the earlier one during the registration. A collision is dropped when
+		*		its ID is registered again under the name it holds, or by ClearCollisions().
+		*/
+		void freeze()
+		{
 			{
-				stringstream strStream;
-				strStream << "unknown function (ID:" << std::showbase << std::uppercase << std::hex << fnID << ")";
-				throw std::runtime_error(strStream.str());
+				std::lock_guard<std::mutex> guard(registry_lock);
+
+				if(!id_collisions.empty())
+				{
+					stringstream strStream;
+					strStream << "function ID collision:";
+
+					for(size_t i = 0; i < id_collisions.size(); i++)
+					{
+						strStream << " '" << id_collisions[i].registered_name << "' and '" << id_collisions[i].new_name 
+							<< "' (ID:" << std::showbase << std::uppercase << std::hex << id_collisions[i].id << std::dec << ")";
+					}
+
+					throw std::runtime_error(strStream.str());
+				}
+
+				bFreeze = true;
+				unpublish();
 			}
-			return retVal;
-		};
 
-		inline InvokerR ExecInvoker(std::string const & strName, paramparser& args)
+			//build the frozen table now rather than at the first dispatch
+			publish();
+		}
+
+		/** drop the frozen table, the dispatch goes back to the dictionary */
+		inline void thaw()
 		{
-			return ExecInvoker(GetInvokerID(strName),args);
-		};
+			std::lock_guard<std::mutex> guard(registry_lock);
+
+			bFreeze = false;
+			unpublish();
+		}
+
+		inline bool IsFrozen() const
+		{
+			std::lock_guard<std::mutex> guard(registry_lock);
+
+			return bFreeze;
+		}
 
 		/**
-		* Parse input for functions to call.
-		* It is the interface for the customization.
+		* Mark the function as independent. The parallel execute() runs the consecutive independent
+		* commands concurrently, so the function must be safe to call from several threads and 
+		* must not depend on the side effect of the other commands in the batch.
+		*
+		* \return false if the function isn't registered
 		*/
-		template<typename T> inline InvokerR parse_input(size_t uFuncID, T const& args)
+		bool SetIndependent(size_t fnID, bool bIndependent = true)
 		{
-			return ExecInvoker(uFuncID, make_param_parser<T,paramparser>(args));
+			std::lock_guard<std::mutex> guard(registry_lock);
+			typename dictionary::iterator itr = map_invokers.find(fnID);
+
+			if(itr == map_invokers.end())
+				return false;
+
+			itr->second.independent = bIndependent;
+			unpublish();
+
+			return true;
 		}
 
-		template<typename T> InvokerR parse_input(T const & args)
+		/** the cache counters of a pure function, they are zero for the other functions */
+		inline memo_stats GetMemoStats(size_t fnID)
 		{
-			InvokerR retVal;
+			reader_scope reader;
+			invoker_info const* pInfo = find_invoker(fnID);
 
-			paramparser parser = make_param_parser<T,paramparser>(args);
+			return pInfo != NULL && pInfo->pMemo != NULL ? pInfo->pMemo->stats() : memo_stats();
+		}
 
-			while (parser.has_more_tokens())
-			{
-				// read function name
-				std::string func_name = parser.get<std::string>();
+		/**
+		* Cache the compiled programs of the last nCapacity input texts, so try_parse_input() and
+		* parse_input() of a repeated text skip the tokenizing, the lookup and the conversion and
+		* only call the functions. A text is compiled again after the registration is changed.
+		* The narrow text input is cached, the other inputs are parsed as before. A cached call
+		* bypasses the result cache of the pure functions. A text which doesn't compile is cached
+		* too, so its repeats go straight to the parsing which reports the error.
+		*/
+		void EnableParseCache(size_t nCapacity = parse_cache_capacity)
+		{
+			std::lock_guard<std::mutex> guard(registry_lock);
 
-				// call the invoker which controls argument parsing
-				retVal = this->ExecInvoker(func_name,parser);
-			}
+			//a cache is retired once no snapshot to be published refers to it
+			unpublish();
 
-			return retVal;
-		};
+			if(pParseCache)
+				retire(std::move(pParseCache));
 
-		//literal string
-		template<int N> InvokerR parse_input(char const (&szText)[N])
+			pParseCache.reset(new parse_cache(nCapacity));
+		}
+
+		void DisableParseCache()
 		{
-			return parse_input(std::string(szText));
-		};
+			std::lock_guard<std::mutex> guard(registry_lock);
 
-		template<> InvokerR parse_input<char *>(char * const & szText)
+			unpublish();
+
+			if(pParseCache)
+				retire(std::move(pParseCache));
+		}
+
+		/** the hit and miss counters of the parse cache, they are zero if it isn't enabled */
+		inline memo_stats GetParseCacheStats()
 		{
-			return parse_input(std::string(szText));
+			reader_scope reader;
+			parse_cache* pCache = current_registry()->pParseCache;
+
+			return pCache != NULL ? pCache->stats() : memo_stats();
+		}
+
+#ifdef DT_PARSE_ARENA
+		/**
+		* Convert the arguments of every try_parse_input() and parse_input() call in a parse_arena
+		* of the calling thread, see parse_arena.hpp. The arena is released when the call returns,
+		* so a function must not keep or return its std::pmr arguments.
+		*/
+		void EnableParseArena(size_t nBytes = parse_arena_size)
+		{
+			std::lock_guard<std::mutex> guard(registry_lock);
+
+			nArenaBytes = nBytes > 0 ? nBytes : 1;
+			unpublish();
+		}
+
+		void DisableParseArena()
+		{
+			std::lock_guard<std::mutex> guard(registry_lock);
+
+			nArenaBytes = 0;
+			unpublish();
+		}
+#endif
+
+		/**
+		* The collisions found during the registration, freeze() reports them. The list is changed
+		* by the registration, so read it once the registration is done.
+		*/
+		inline std::vector<invoker_collision> const & GetCollisions() const
+		{
+			return id_collisions;
+		}
+
+		/** acknowledge the collisions, the overwritten functions stay overwritten */
+		inline void ClearCollisions()
+		{
+			std::lock_guard<std::mutex> guard(registry_lock);
+
+			id_collisions.clear();
+		}
+
+		/**
+		* Return the specified function ID. 
+		* 
+		* \param name		the method name
+		* \param bVerify	true means need verify ID whether it exists in the invoker list. false means
+							just generate ID based on the name
+
+		* \return 0 means the specified function isn't registered.
+		*/
+		inline size_t GetInvokerID(std::string const & name, bool bVerify = true)
+		{
+			size_t fnID = hash_fn(name);
+			reader_scope reader;
+			 
+			if(bVerify && find_invoker(fnID) == NULL)
+				fnID = 0;
+
+			return fnID;
+		}
+
+		inline bool IsRegisteredID(size_t ID)
+		{
+			reader_scope reader;
+
+			return (find_invoker(ID) != NULL);
+		}
+
+		/**
+		* The interned name of the function. It isn't copied, the reference stays valid until the
+		* interpreter is destroyed.
+		*
+		* \return the empty string if the function isn't registered
+		*/
+		inline std::string const& GetInvokerName(size_t ID)
+		{
+			reader_scope reader;
+			invoker_info const* pInfo = find_invoker(ID);
+
+			return pInfo != NULL ? *pInfo->pName : empty_name();
+		}
+
+		/**
+		* The compact ID of the function name. The symbols are numbered from 0 in the order the names
+		* are registered first, so they can index a plain array.
+		*
+		* \return no_symbol if the function isn't registered
+		*/
+		inline symbol_id GetInvokerSymbol(size_t ID)
+		{
+			reader_scope reader;
+			invoker_info const* pInfo = find_invoker(ID);
+
+			return pInfo != NULL ? pInfo->symbol : no_symbol;
+		}
+
+		/** \return the empty string if the symbol isn't known */
+		inline std::string const& GetSymbolName(symbol_id symbol)
+		{
+			reader_scope reader;
+			registry const* pRegistry = current_registry();
+
+			return symbol < pRegistry->symbol_names.size() ? *pRegistry->symbol_names[symbol] : empty_name();
+		}
+
+		/**
+		* The call metrics of TryExecInvoker(), ExecInvoker(), parse_input() and execute() by the
+		* function name.
+		* The functions which aren't called are left out.
+		*
+		* \return empty if DT_INTERPRETER_METRICS isn't defined
+		*/
+		std::map<std::string, function_metrics> GetMetrics()
+		{
+			std::map<std::string, function_metrics> result;
+
+#ifdef DT_INTERPRETER_METRICS
+			reader_scope reader;
+			registry const* pRegistry = current_registry();
+			std::vector<function_metrics> merged = metrics.merge(pRegistry->symbol_names.size());
+
+			for(size_t i = 0; i < merged.size(); i++)
+			{
+				if(merged[i].calls > 0)
+					result[*pRegistry->symbol_names[i]] = merged[i];
+			}
+#endif
+
+			return result;
+		}
+
+		/**
+		* Call the function without throwing for an unknown function or an invalid argument. The
+		* exception thrown by the function itself still goes to the caller.
+		*/
+		inline invoker_result<InvokerR> TryExecInvoker(size_t fnID, paramparser& args)
+		{
+			invoker_error err = {invoker_ok, fnID, 0};
+			reader_scope reader;
+			invoker_info const* pInfo = find_invoker(fnID);
+
+			if(pInfo == NULL)
+			{
+				err.code = invoker_unknown_function;
+				return invoker_result<InvokerR>::failure(err);
+			}
+
+#ifdef DT_INTERPRETER_METRICS
+			call_timer timer(metrics.local_cell(pInfo->symbol));
+#endif
+			InvokerR retVal = InvokerR();
+
+			if(!pInfo->invoke(args, retVal, NULL, err))
+				return invoker_result<InvokerR>::failure(err);
+
+#ifdef DT_INTERPRETER_METRICS
+			timer.succeeded();
+#endif
+			return invoker_result<InvokerR>(std::move(retVal));
+		}
+
+		inline invoker_result<InvokerR> TryExecInvoker(std::string const & strName, paramparser& args)
+		{
+			return TryExecInvoker(hash_fn(strName), args);
+		}
+
+		/**
+		* The typed TryExecInvoker(), R is the return type of the function or the value type of
+		* its future. The result isn't converted to InvokerR, so there is no type erasure or
+		* allocation for it.
+		*/
+		template<typename R>
+		inline invoker_result<R> TryExecInvoker(size_t fnID, paramparser& args)
+		{
+			invoker_error err = {invoker_ok, fnID, 0};
+			reader_scope reader;
+			invoker_info const* pInfo = find_invoker(fnID);
+
+			if(pInfo == NULL)
+			{
+				err.code = invoker_unknown_function;
+				return invoker_result<R>::failure(err);
+			}
+
+#ifdef DT_INTERPRETER_METRICS
+			call_timer timer(metrics.local_cell(pInfo->symbol));
+#endif
+			R retVal = R();
+
+			if(!pInfo->invoke_typed(args, &retVal, typeid(R), err))
+				return invoker_result<R>::failure(err);
+
+#ifdef DT_INTERPRETER_METRICS
+			timer.succeeded();
+#endif
+			return invoker_result<R>(std::move(retVal));
+		}
+
+		/** \throw std::runtime_error for an unknown function, an invalid argument or another return type */
+		template<typename R>
+		inline R ExecInvoker(size_t fnID, paramparser& args)
+		{
+			return std::move(TryExecInvoker<R>(fnID, args).value());
+		}
+
+		/** \throw std::runtime_error for an unknown function or an invalid argument */
+		inline InvokerR ExecInvoker(size_t fnID, paramparser& args)
+		{
+			return std::move(TryExecInvoker(fnID, args).value());
+		};
+
+		inline InvokerR ExecInvoker(std::string const & strName, paramparser& args)
+		{
+			return ExecInvoker(GetInvokerID(strName),args);
+		};
+
+		/**
+		* Apply the function to nRows rows of the columns, the column k is the argument k. A column
+		* is the parameter type without the reference and the cv qualifiers, and pOut is nRows
+		* values of the return type or the value type of its future. There is no lookup, parsing
+		* or type erasure per row.
+		*
+		* \return the row count, or invoker_argument_mismatch / invoker_result_mismatch for the types
+		*/
+		template<typename R, typename... Columns>
+		invoker_result<size_t> TryApplyBatch(size_t fnID, size_t nRows, R* pOut, Columns const*... pColumns)
+		{
+			invoker_error err = {invoker_ok, fnID, 0};
+			reader_scope reader;
+			invoker_info const* pInfo = find_invoker(fnID);
+
+			if(pInfo == NULL)
+			{
+				err.code = invoker_unknown_function;
+				return invoker_result<size_t>::failure(err);
+			}
+
+			void const* columns[] = { NULL, static_cast<void const*>(pColumns)... };
+			std::type_info const* types[] = { NULL, &typeid(Columns)... };
+			batch_args batch = { columns + 1, types + 1, sizeof...(Columns), nRows, static_cast<void*>(pOut), &typeid(R) };
+
+			if(!pInfo->apply_batch(batch, err))
+				return invoker_result<size_t>::failure(err);
+
+			return invoker_result<size_t>(nRows);
+		}
+
+		/** \throw std::runtime_error for an unknown function or the other column or result types */
+		template<typename R, typename... Columns>
+		inline size_t ApplyBatch(size_t fnID, size_t nRows, R* pOut, Columns const*... pColumns)
+		{
+			return TryApplyBatch(fnID, nRows, pOut, pColumns...).value();
+		}
+
+		/**
+		* Apply the function to the columns of a tuple_codec, the output is resized to the rows.
+		*
+		* \throw std::runtime_error if the columns have different lengths, or like ApplyBatch()
+		*/
+		template<typename R, typename... Fields>
+		size_t ApplyBatch(size_t fnID, std::tuple< std::vector<Fields>... > const & columns, std::vector<R> & out)
+		{
+			return apply_columns(fnID, columns, out, std::index_sequence_for<Fields...>());
+		}
+
+		/**
+		* Parse input for functions to call.
+		* It is the interface for the customization.
+		*/
+		template<typename T> inline InvokerR parse_input(size_t uFuncID, T const& args)
+		{
+			paramparser parser = make_param_parser<T,paramparser>(args);
+
+			return ExecInvoker(uFuncID, parser);
+		}
+
+		template<typename T> InvokerR parse_input(T const & args)
+		{
+			return std::move(try_parse_input(args).value());
+		};
+
+		//literal string
+		InvokerR parse_input(char * szText)
+		{
+			return parse_input(std::string(szText));
+		};
+
+		InvokerR parse_input(char const* szText)
+		{
+			return parse_input(std::string(szText));
+		};
+
+		/**
+		* The non-throwing parse_input(). It stops at the first unknown function or invalid argument
+		* and returns the error, the commands before it have run already.
+		*/
+		template<typename T> invoker_result<InvokerR> try_parse_input(T const & args)
+		{
+			invoker_result<InvokerR> result;
+			reader_scope reader;
+			registry const* pRegistry = current_registry();
+
+			if(pRegistry->pParseCache != NULL && try_parse_cached(args, result))
+				return result;
+
+#ifdef DT_PARSE_ARENA
+			if(pRegistry->nArenaBytes > 0)
+			{
+				parse_arena::scope arena_scope(thread_arena(pRegistry->nArenaBytes));
+
+				return parse_commands(args);
+			}
+#endif
+
+			return parse_commands(args);
+		};
+
+#ifdef DT_PARSE_ARENA
+		/** try_parse_input() in the caller's arena, it is released when the call returns */
+		template<typename T> invoker_result<InvokerR> try_parse_input(T const & args, parse_arena & arena)
+		{
+			parse_arena::scope arena_scope(arena);
+
+			return parse_commands(args);
+		}
+
+		template<typename T> InvokerR parse_input(T const & args, parse_arena & arena)
+		{
+			return std::move(try_parse_input(args, arena).value());
+		}
+#endif
+
+	protected:
+		template<typename T> invoker_result<InvokerR> parse_commands(T const & args)
+		{
+			invoker_result<InvokerR> result;
+
+			paramparser parser = make_param_parser<T,paramparser>(args);
+
+			while (parser.has_more_tokens())
+			{
+				// read function name
+				std::string func_name = parser.template get<std::string>();
+
+				// call the invoker which controls argument parsing
+				result = this->TryExecInvoker(func_name, parser);
+
+				if(!result)
+					break;
+			}
+
+			return result;
+		}
+
+#ifdef DT_PARSE_ARENA
+		// the arena of the calling thread, it grows to the biggest size asked while it isn't used
+		static parse_arena& thread_arena(size_t nBytes)
+		{
+			static thread_local std::unique_ptr<parse_arena> pArena;
+
+			if(!pArena || (pArena->capacity() < nBytes && !pArena->in_use()))
+				pArena.reset(new parse_arena(nBytes));
+
+			return *pArena;
+		}
+#endif
+
+	public:
+		invoker_result<InvokerR> try_parse_input(char * szText)
+		{
+			return try_parse_input(std::string(szText));
+		};
+
+		invoker_result<InvokerR> try_parse_input(char const* szText)
+		{
+			return try_parse_input(std::string(szText));
+		};
+
+		/**
+		* Parse the input like parse_input(), but don't wait for the asynchronous functions (see
+		* is_async_result). The following commands marked by SetIndependent() are parsed and
+		* called while the earlier ones are pending, so one thread keeps many slow calls in 
+		* flight. Any other command waits for the pending ones first, and the commands after it
+		* wait for it.
+		*
+		* \return the result of every command in the input order
+		* \throw std::runtime_error for an unknown function or an invalid argument, or the first
+		*		exception of the functions in the input order
+		*/
+		template<typename T> std::vector<InvokerR> async_parse_input(T const & args)
+		{
+			std::vector<InvokerR> results;
+			pending_list pending;
+			reader_scope reader;
+
+			paramparser parser = make_param_parser<T,paramparser>(args);
+
+			while (parser.has_more_tokens())
+			{
+				size_t fnID = hash_fn(parser.template get<std::string>());
+				invoker_info const* pInfo = find_invoker(fnID);
+
+				if(pInfo == NULL)
+					throw_unknown_function(fnID);
+
+				if(!pInfo->independent)
+					wait_pending(pending, results);
+
+				invoker_error err = {invoker_ok, fnID, 0};
+				pending_call* pCall = NULL;
+
+				results.push_back(InvokerR());
+
+				if(!pInfo->invoke(parser, results.back(), &pCall, err))
+					throw std::runtime_error(err.message());
+
+				if(pCall != NULL)
+				{
+					pending.push_back(pending_entry(results.size() - 1, std::unique_ptr<pending_call>(pCall)));
+
+					if(!pInfo->independent)
+						wait_pending(pending, results);
+				}
+			}
+
+			wait_pending(pending, results);
+
+			return results;
+		}
+
+		std::vector<InvokerR> async_parse_input(char const* szText)
+		{
+			return async_parse_input(std::string(szText));
+		}
+
+		/**
+		* The script compiled by compile(). The function IDs are resolved and the arguments are
+		* converted, so execute() only dispatches the commands. It keeps its own copy of the script 
+		* because the converted arguments may be views into the text. The registered functions are 
+		* bound at the compile time, registering them again doesn't change a compiled program.
+		*/
+		class program
+		{
+			friend class interpreter;
+
+		public:
+			inline size_t size() const
+			{
+				return commands.size();
+			}
+
+			inline bool empty() const
+			{
+				return commands.empty();
+			}
+
+		protected:
+			std::shared_ptr<void const> source;
+			std::vector< std::unique_ptr<compiled_command> > commands;
+		};
+
+		/**
+		* Parse the script once into a program for execute(). 
+		*
+		* \throw std::runtime_error for an unknown function or an invalid argument, like parse_input()
+		*/
+		template<typename T> program compile(T const & args)
+		{
+#ifdef DT_PARSE_ARENA
+			// the arguments of a program outlive the call
+			parse_resource_scope default_resource(NULL);
+#endif
+			program prog;
+			std::shared_ptr<T const> pSource = std::make_shared<T const>(args);
+
+			prog.source = pSource;
+			reader_scope reader;
+
+			paramparser parser = make_param_parser<T,paramparser>(*pSource);
+
+			while (parser.has_more_tokens())
+			{
+				size_t fnID = hash_fn(parser.template get<std::string>());
+				invoker_info const* pInfo = find_invoker(fnID);
+
+				if(pInfo == NULL)
+					throw_unknown_function(fnID);
+
+				prog.commands.push_back(std::unique_ptr<compiled_command>(pInfo->compile(parser)));
+				prog.commands.back()->independent = pInfo->independent;
+				prog.commands.back()->symbol = pInfo->symbol;
+			}
+
+			return prog;
+		}
+
+		program compile(char const* szText)
+		{
+			return compile(std::string(szText));
+		}
+
+	protected:
+		/**
+		* The program of a cached text, it is valid for the registry generation it was compiled with.
+		* The program is NULL if the text doesn't compile.
+		*/
+		struct parsed_text
+		{
+			size_t generation;
+			std::shared_ptr<program const> prog;
+
+			parsed_text() : generation(0) { }
+		};
+
+		struct parse_cache : memo_cache<std::string, parsed_text>
+		{
+			explicit parse_cache(size_t nCapacity) : memo_cache<std::string, parsed_text>(nCapacity)
+			{ }
+		};
+
+		// only the narrow text is cached
+		template<typename T> inline bool try_parse_cached(T const &, invoker_result<InvokerR> &)
+		{
+			return false;
+		}
+
+#ifdef __cpp_lib_string_view
+		inline bool try_parse_cached(std::string_view text, invoker_result<InvokerR> & result)
+		{
+			return try_parse_cached(std::string(text), result);
+		}
+#endif
+
+		/**
+		* Run the cached program of the text, a missing or outdated one is compiled and cached.
+		*
+		* \return false if the text doesn't compile, the caller parses it to report the error
+		*/
+		bool try_parse_cached(std::string const & text, invoker_result<InvokerR> & result)
+		{
+			registry const* pRegistry = current_registry();
+			parse_cache* pCache = pRegistry->pParseCache;
+			parsed_text cached;
+
+			if(!pCache->visit(text, [&cached](parsed_text const & entry) { cached = entry; }) || cached.generation != pRegistry->generation)
+			{
+				cached.prog.reset();
+				cached.generation = pRegistry->generation;
+
+				try
+				{
+					cached.prog = std::make_shared<program const>(compile(text));
+				}
+				catch(std::runtime_error&)
+				{
+				}
+
+				pCache->insert_or_assign(std::string(text), cached);
+			}
+
+			if(!cached.prog)
+				return false;
+
+			result = invoker_result<InvokerR>(execute(*cached.prog));
+
+			return true;
+		}
+
+	public:
+
+		/**
+		* Run the compiled program. No tokenizing, hashing or argument conversion is done here.
+		*
+		* \return the result of the last command, like parse_input()
+		*/
+		InvokerR execute(program const & prog)
+		{
+			InvokerR retVal = InvokerR();
+
+			for(size_t i = 0; i < prog.commands.size(); i++)
+				retVal = call_command(*prog.commands[i]);
+
+			return retVal;
+		}
+
+		/**
+		* Run the compiled program on the pool. The consecutive commands marked by SetIndependent()
+		* run concurrently, any other command waits for the commands before it and runs alone.
+		* The independent commands after a failed one may have run already.
+		*
+		* \return the result of every command in the input order
+		* \throw the first exception in the input order
+		*/
+		std::vector<InvokerR> execute(program const & prog, work_stealing_pool & pool)
+		{
+			const size_t nCount = prog.commands.size();
+			std::vector<InvokerR> results(nCount);
+			std::vector<std::exception_ptr> errors(nCount);
+			size_t nFirst = 0;
+
+			while(nFirst < nCount)
+			{
+				if(!prog.commands[nFirst]->independent)
+				{
+					results[nFirst] = call_command(*prog.commands[nFirst]);
+					nFirst++;
+					continue;
+				}
+
+				size_t nLast = nFirst;
+				while(nLast < nCount && prog.commands[nLast]->independent)
+					nLast++;
+
+				pool.parallel_for(nLast - nFirst, [&](size_t i) {
+					try
+					{
+						results[nFirst + i] = call_command(*prog.commands[nFirst + i]);
+					}
+					catch(...)
+					{
+						errors[nFirst + i] = std::current_exception();
+					}
+				});
+
+				for(size_t i = nFirst; i < nLast; i++)
+				{
+					if(errors[i])
+						std::rethrow_exception(errors[i]);
+				}
+
+				nFirst = nLast;
+			}
+
+			return results;
+		}
+
+		/** compile the script and run it on the pool, see execute() */
+		template<typename T> std::vector<InvokerR> parallel_parse_input(T const & args, work_stealing_pool & pool)
+		{
+			return execute(compile(args), pool);
+		}
+
+		std::vector<InvokerR> parallel_parse_input(char const* szText, work_stealing_pool & pool)
+		{
+			return execute(compile(szText), pool);
+		}
+
+	protected:
+		// the ID is registered again under the name it holds, under registry_lock
+		inline void drop_collisions(size_t fnID)
+		{
+			size_t nKept = 0;
+			for(size_t i = 0; i < id_collisions.size(); i++)
+			{
+				if(id_collisions[i].id != fnID)
+					id_collisions[nKept++] = id_collisions[i];
+			}
+
+			id_collisions.resize(nKept);
+		}
+
+		// the compiled call with its metrics
+		inline InvokerR call_command(compiled_command const & command)
+		{
+#ifdef DT_INTERPRETER_METRICS
+			call_timer timer(metrics.local_cell(command.symbol));
+			InvokerR retVal = command.call();
+
+			timer.succeeded();
+			return retVal;
+#else
+			return command.call();
+#endif
+		}
+
+		/**
+		* Add the invoker into the dictionary. If the ID is already used by another name, the old
+		* invoker is overwritten and the collision is recorded for freeze() to report. The memo
+		* or the pipeline of the overwritten invoker is retired.
+		*/
+		template<typename Binder>
+		inline size_t add_invoker(size_t fnID, std::string const& name, Binder const& binder, memo_base* pMemo = NULL,
+			std::shared_ptr<void const> pPipeline = std::shared_ptr<void const>())
+		{
+			std::lock_guard<std::mutex> guard(registry_lock);
+			typename dictionary::iterator itr = map_invokers.find(fnID);
+
+			symbol_id symbol = symbols.intern(name);
+
+			//the names are interned, the same name has the same symbol
+			if(itr != map_invokers.end() && itr->second.symbol != symbol)
+			{
+				invoker_collision collision = {fnID, *itr->second.pName, name};
+				id_collisions.push_back(collision);
+			}
+			else if(itr != map_invokers.end())
+				drop_collisions(fnID);
+
+			invoker_info& info = map_invokers[fnID];
+			info.pName = &symbols.name(symbol);
+			info.symbol = symbol;
+			info.invoke = invoker_function(binder);
+			info.invoke_typed = typed_invoker_function(typed_binder<Binder>(binder));
+			info.apply_batch = batch_invoker_function(batch_binder<Binder>(binder));
+			info.compile = compiler_function(compile_binder<Binder>(binder));
+			memo_base* pReplaced = info.pMemo != pMemo ? info.pMemo : NULL;
+			info.pMemo = pMemo;
+
+			std::shared_ptr<void const> pReplacedPipeline;
+			typename std::unordered_map< size_t, std::shared_ptr<void const> >::iterator itrPipeline = pipelines.find(fnID);
+
+			if(itrPipeline != pipelines.end())
+			{
+				pReplacedPipeline = std::move(itrPipeline->second);
+				pipelines.erase(itrPipeline);
+			}
+
+			if(pPipeline)
+				pipelines[fnID] = std::move(pPipeline);
+
+			//the registered set is changed, the frozen table has to be built again by freeze()
+			bFreeze = false;
+			unpublish();
+
+			if(pReplaced != NULL)
+				retire_memo(pReplaced);
+
+			if(pReplacedPipeline)
+				retire(std::move(pReplacedPipeline));
+
+			return fnID;
+		}
+
+		template<typename TheClass, typename... Functions, size_t... Is>
+		inline void register_entries(function_table<Functions...> const & table, TheClass* theclass, std::index_sequence<Is...>)
+		{
+			int dummy[] = { 0, (register_entry(std::get<Is>(table.entries), theclass), 0)... };
+			(void)dummy;
+		}
+
+		template<typename Function, typename TheClass>
+		inline typename boost::enable_if_c< callable_traits<Function>::is_member >::type
+			register_entry(function_entry<Function> const & entry, TheClass* theclass)
+		{
+			add_invoker(entry.id, entry.name, member_function_binder<Function,TheClass>(entry.func, theclass));
+		}
+
+		template<typename Function, typename TheClass>
+		inline typename boost::enable_if_c< !callable_traits<Function>::is_member >::type
+			register_entry(function_entry<Function> const & entry, TheClass*)
+		{
+			add_invoker(entry.id, entry.name, function_binder<Function>(entry.func));
+		}
+
+		template<typename R, typename... Fields, size_t... Is>
+		size_t apply_columns(size_t fnID, std::tuple< std::vector<Fields>... > const & columns, std::vector<R> & out, std::index_sequence<Is...>)
+		{
+			size_t sizes[] = { 0, std::get<Is>(columns).size()... };
+			size_t nRows = sizeof...(Fields) > 0 ? sizes[1] : 0;
+
+			for(size_t i = 1; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+			{
+				if(sizes[i] != nRows)
+					throw std::runtime_error("the columns have different lengths");
+			}
+
+			out.resize(nRows);
+
+			return ApplyBatch(fnID, nRows, out.data(), std::get<Is>(columns).data()...);
+		}
+
+		/** add the invoker of a pure function, its cache is owned by the interpreter */
+		template<typename Binder>
+		inline size_t add_pure_invoker(size_t fnID, std::string const& name, Binder const& binder, pure_function const & pure)
+		{
+			memo_state<Binder>* pState = new memo_state<Binder>(binder, pure.capacity);
+
+			{
+				std::lock_guard<std::mutex> guard(registry_lock);
+				memos.push_back(std::unique_ptr<memo_base>(pState));
+			}
+
+			return add_invoker(fnID, name, memo_binder<Binder>(pState), pState);
+		}
+
+		/** build the snapshot of the current registration and publish it for the dispatch */
+		registry const* publish()
+		{
+			std::lock_guard<std::mutex> guard(registry_lock);
+			registry const* pPublished = published.load();
+
+			if(pPublished != NULL)
+				return pPublished;
+
+			registry* pRegistry = new registry();
+			std::shared_ptr<registry const> pOwner(pRegistry);
+
+			pRegistry->map_invokers = map_invokers;
+			pRegistry->pParseCache = pParseCache.get();
+			pRegistry->nArenaBytes = nArenaBytes;
+			pRegistry->generation = ++nGenerations;
+
+			pRegistry->symbol_names.reserve(symbols.size());
+			for(symbol_id symbol = 0; symbol < symbols.size(); symbol++)
+				pRegistry->symbol_names.push_back(&symbols.name(symbol));
+
+			if(bFreeze)
+				build_frozen_table(*pRegistry);
+
+			if(pLatest)
+				retire(std::move(pLatest));
+
+			pLatest = pOwner;
+			published.store(pRegistry);
+			reclaim();
+
+			return pRegistry;
+		}
+
+		/** drop the published snapshot after a change, the next reader publishes a new one */
+		inline void unpublish()
+		{
+			published.store(NULL);
+		}
+
+		/** pin the snapshots the thread reads for the scope, the scopes nest */
+		typedef reader_epoch::scope reader_scope;
+
+		// under registry_lock, after the object is made unreachable by unpublish()
+		inline void retire(std::shared_ptr<void const> pObject)
+		{
+			retired_object object = {reader_epoch::current(), std::move(pObject)};
+
+			retired.push_back(std::move(object));
+		}
+
+		// under registry_lock
+		inline void retire_memo(memo_base* pMemo)
+		{
+			for(size_t i = 0; i < memos.size(); i++)
+			{
+				if(memos[i].get() == pMemo)
+				{
+					retire(std::shared_ptr<void const>(std::move(memos[i])));
+					memos.erase(memos.begin() + i);
+					return;
+				}
+			}
+		}
+
+		/**
+		* Free the retired objects no reader can see, under registry_lock. It never waits, the
+		* objects a reader may still see are freed by a later publish().
+		*/
+		void reclaim()
+		{
+			if(retired.empty())
+				return;
+
+			//the objects are unreachable, two advances make them invisible
+			reader_epoch::try_advance();
+			size_t nEpoch = reader_epoch::try_advance();
+
+			size_t nKept = 0;
+			for(size_t i = 0; i < retired.size(); i++)
+			{
+				if(retired[i].epoch + 2 > nEpoch)
+					retired[nKept++] = std::move(retired[i]);
+			}
+
+			retired.resize(nKept);
+		}
+
+		static void build_frozen_table(registry& reg)
+		{
+			std::vector<size_t> ids, slots, best_slots;
+			for(typename dictionary::const_iterator itr = reg.map_invokers.begin(); itr != reg.map_invokers.end(); ++itr)
+				ids.push_back(itr->first);
+
+			size_t nMinBits = 1;
+			while(((size_t)1 << nMinBits) < ids.size())
+				nMinBits++;
+
+			//try the load factor 1/2 to 1/8 and keep the seed with the least probes
+			size_t best_bits = 0, best_seed = 0, best_probes = 0;
+			for(size_t nBits = nMinBits + 1; nBits <= nMinBits + 3 && best_probes != 1; nBits++)
+			{
+				size_t seed = (size_t)0x9E3779B97F4A7C15ULL;
+
+				for(int nTry = 0; nTry < 64 && best_probes != 1; nTry++)
+				{
+					size_t probes = place_ids(ids, nBits, seed, slots);
+
+					if(best_probes == 0 || probes < best_probes)
+					{
+						best_bits = nBits;
+						best_seed = seed;
+						best_probes = probes;
+						best_slots.swap(slots);
+					}
+
+					seed = (size_t)(seed * 6364136223846793005ULL + 1442695040888963407ULL) | 1;
+				}
+			}
+
+			reg.frozen_table.assign((size_t)1 << best_bits, frozen_slot());
+			for(size_t i = 0; i < ids.size(); i++)
+			{
+				frozen_slot& slot = reg.frozen_table[best_slots[i]];
+				slot.id = ids[i];
+				slot.info = reg.map_invokers[ids[i]];
+			}
+
+			reg.frozen_seed = best_seed;
+			reg.frozen_shift = sizeof(size_t) * CHAR_BIT - best_bits;
+			reg.frozen_probes = best_probes;
+		}
+
+		/**
+		* Put the IDs into a table of 2^nBits slots with linear probing. 
+		*
+		* \return the max probe count for the lookup, 1 means every ID got its own home slot
+		*/
+		static size_t place_ids(std::vector<size_t> const& ids, size_t nBits, size_t seed, std::vector<size_t>& slots)
+		{
+			const size_t mask = ((size_t)1 << nBits) - 1;
+			const size_t shift = sizeof(size_t) * CHAR_BIT - nBits;
+			std::vector<bool> used(mask + 1, false);
+			size_t maxProbes = 1;
+
+			slots.resize(ids.size());
+			for(size_t i = 0; i < ids.size(); i++)
+			{
+				size_t pos = (ids[i] * seed) >> shift;
+				size_t probes = 1;
+
+				while(used[pos])
+				{
+					pos = (pos + 1) & mask;
+					probes++;
+				}
+
+				used[pos] = true;
+				slots[i] = pos;
+
+				if(probes > maxProbes)
+					maxProbes = probes;
+			}
+
+			return maxProbes;
+		}
+
+		/** the published snapshot, a new one is published if the registration changed */
+		inline registry const* current_registry()
+		{
+			registry const* pRegistry = published.load();
+
+			return pRegistry != NULL ? pRegistry : publish();
+		}
+
+		static inline std::string const& empty_name()
+		{
+			static const std::string strEmpty;
+
+			return strEmpty;
+		}
+
+		/** find the invoker from the frozen table if it is frozen, otherwise from the dictionary */
+		inline invoker_info const* find_invoker(size_t fnID)
+		{
+			registry const* pRegistry = current_registry();
+
+			if(pRegistry->frozen_probes > 0)
+			{
+				const size_t mask = pRegistry->frozen_table.size() - 1;
+				size_t pos = (fnID * pRegistry->frozen_seed) >> pRegistry->frozen_shift;
+
+				for(size_t n = 0; n < pRegistry->frozen_probes; n++, pos = (pos + 1) & mask)
+				{
+					frozen_slot const& slot = pRegistry->frozen_table[pos];
+
+					if(slot.id == fnID && !slot.info.invoke.empty())
+						return &slot.info;
+				}
+
+				return NULL;
+			}
+
+			typename dictionary::const_iterator itr = pRegistry->map_invokers.find(fnID);
+
+			return (itr != pRegistry->map_invokers.end()) ? &itr->second : NULL;
+		}
+
+		typedef std::pair< size_t, std::unique_ptr<pending_call> > pending_entry;
+		typedef std::vector<pending_entry> pending_list;
+
+		/** collect the pending results in the input order */
+		static void wait_pending(pending_list & pending, std::vector<InvokerR> & results)
+		{
+			pending_list calls;
+			calls.swap(pending);
+
+			for(size_t i = 0; i < calls.size(); i++)
+				results[calls[i].first] = calls[i].second->get();
+		}
+
+		/**
+		* Store the result of the function. An asynchronous result is handed out as a pending call
+		* if ppCall isn't NULL, otherwise it is waited for.
+		*/
+		template<typename R>
+		static inline void take_result(R && result, InvokerR & retVal, pending_call ** ppCall)
+		{
+			take_result(std::forward<R>(result), retVal, ppCall, is_async_result<typename std::decay<R>::type>());
+		}
+
+		template<typename R>
+		static inline void take_result(R && result, InvokerR & retVal, pending_call **, std::false_type)
+		{
+			retVal = std::forward<R>(result);
+		}
+
+		template<typename R>
+		static inline void take_result(R && result, InvokerR & retVal, pending_call ** ppCall, std::true_type)
+		{
+			if(ppCall != NULL)
+				*ppCall = new future_call<typename std::decay<R>::type>(std::forward<R>(result));
+			else
+				retVal = result.get();
+		}
+
+		static void throw_unknown_function(size_t fnID)
+		{
+			invoker_error err = {invoker_unknown_function, fnID, 0};
+			throw std::runtime_error(err.message());
+		}
+
+	private:
+		template< typename Function, typename ArgTypes = typename callable_traits<Function>::arg_types >
+		struct invoker;
+
+		// the registered function bound to its invoker, it is stored inline in the invoker_function
+		template<typename Function>
+		struct function_binder
+		{
+			typedef Function function_type;
+
+			Function func;
+
+			explicit function_binder(Function f) : func(f)
+			{ }
+
+			inline bool operator()(paramparser & parser, InvokerR & retVal, pending_call ** ppCall, invoker_error & err) const
+			{
+				return invoker<Function>::apply(func, static_cast<void*>(NULL), parser, erased_result(retVal, ppCall), err);
+			}
+
+			inline bool invoke_typed(paramparser & parser, void * pResult, std::type_info const & type, invoker_error & err) const
+			{
+				return invoker<Function>::apply_typed(func, static_cast<void*>(NULL), parser, pResult, type, err);
+			}
+
+			inline compiled_command* compile(paramparser & parser) const
+			{
+				return invoker<Function>::compile(func, static_cast<void*>(NULL), parser);
+			}
+
+			template<typename ResultSink, typename Cache>
+			inline bool apply_memo(paramparser & parser, ResultSink const & sink, Cache & cache, invoker_error & err) const
+			{
+				return invoker<Function>::apply_memo(func, static_cast<void*>(NULL), parser, sink, cache, err);
+			}
+
+			inline bool apply_batch(batch_args const & batch, invoker_error & err) const
+			{
+				return invoker<Function>::apply_batch(func, static_cast<void*>(NULL), batch, err);
+			}
+		};
+
+		template<typename Function, typename TheClass>
+		struct member_function_binder
+		{
+			typedef Function function_type;
+
+			Function func;
+			TheClass* theclass;
+
+			member_function_binder(Function f, TheClass* obj) : func(f), theclass(obj)
+			{ }
+
+			inline bool operator()(paramparser & parser, InvokerR & retVal, pending_call ** ppCall, invoker_error & err) const
+			{
+				return invoker<Function>::apply(func, theclass, parser, erased_result(retVal, ppCall), err);
+			}
+
+			inline bool invoke_typed(paramparser & parser, void * pResult, std::type_info const & type, invoker_error & err) const
+			{
+				return invoker<Function>::apply_typed(func, theclass, parser, pResult, type, err);
+			}
+
+			inline compiled_command* compile(paramparser & parser) const
+			{
+				return invoker<Function>::compile(func, theclass, parser);
+			}
+
+			template<typename ResultSink, typename Cache>
+			inline bool apply_memo(paramparser & parser, ResultSink const & sink, Cache & cache, invoker_error & err) const
+			{
+				return invoker<Function>::apply_memo(func, theclass, parser, sink, cache, err);
+			}
+
+			inline bool apply_batch(batch_args const & batch, invoker_error & err) const
+			{
+				return invoker<Function>::apply_batch(func, theclass, batch, err);
+			}
+		};
+
+		// the typed entry of a binder, it is stored inline in the typed_invoker_function
+		template<typename Binder>
+		struct typed_binder : Binder
+		{
+			explicit typed_binder(Binder const& binder) : Binder(binder)
+			{ }
+
+			inline bool operator()(paramparser & parser, void * pResult, std::type_info const & type, invoker_error & err) const
+			{
+				return Binder::invoke_typed(parser, pResult, type, err);
+			}
+		};
+
+		// the batch entry of a binder, it is stored inline in the batch_invoker_function
+		template<typename Binder>
+		struct batch_binder : Binder
+		{
+			explicit batch_binder(Binder const& binder) : Binder(binder)
+			{ }
+
+			inline bool operator()(batch_args const & batch, invoker_error & err) const
+			{
+				return Binder::apply_batch(batch, err);
+			}
+		};
+
+		// the result of the invoker entry, it is InvokerR or the pending call of an asynchronous function
+		struct erased_result
+		{
+			InvokerR & retVal;
+			pending_call ** ppCall;
+
+			erased_result(InvokerR & ret, pending_call ** pp) : retVal(ret), ppCall(pp)
+			{ }
+
+			template<typename R>
+			inline void operator()(R && result) const
+			{
+				take_result(std::forward<R>(result), retVal, ppCall);
+			}
+		};
+
+		// the result of the typed entry, an asynchronous result is waited for
+		template<typename Value>
+		struct typed_result
+		{
+			Value * pValue;
+
+			template<typename R>
+			inline void operator()(R && result) const
+			{
+				store(std::forward<R>(result), is_async_result<typename std::decay<R>::type>());
+			}
+
+			template<typename R>
+			inline void store(R && result, std::false_type) const
+			{
+				*pValue = std::forward<R>(result);
+			}
+
+			template<typename R>
+			inline void store(R && result, std::true_type) const
+			{
+				*pValue = result.get();
+			}
+		};
+
+		// the compile entry of a binder, it is stored inline in the compiler_function
+		template<typename Binder>
+		struct compile_binder : Binder
+		{
+			explicit compile_binder(Binder const& binder) : Binder(binder)
+			{ }
+
+			inline compiled_command* operator()(paramparser & parser) const
+			{
+				return Binder::compile(parser);
+			}
+		};
+
+		// the binder of a pure function with its result cache
+		template<typename Binder>
+		struct memo_state : memo_base
+		{
+			typedef invoker<typename Binder::function_type> invoker_type;
+			typedef typename invoker_type::memo_cache_type cache_type;
+
+			static_assert(invoker_type::is_memo_result, "a pure function returns a value to be cached, not void or a future");
+			static_assert(invoker_type::is_memo_params, "a pure function doesn't take a non-const reference");
+
+			Binder binder;
+			cache_type cache;
+
+			memo_state(Binder const& b, size_t nCapacity) : binder(b), cache(nCapacity)
+			{ }
+
+			virtual memo_stats stats()
+			{
+				return cache.stats();
+			}
+		};
+
+		// the entries of a pure function, they refer to its memo_state to fit the inline storage
+		template<typename Binder>
+		struct memo_binder
+		{
+			memo_state<Binder>* pState;
+
+			explicit memo_binder(memo_state<Binder>* p) : pState(p)
+			{ }
+
+			inline bool operator()(paramparser & parser, InvokerR & retVal, pending_call ** ppCall, invoker_error & err) const
+			{
+				return pState->binder.apply_memo(parser, erased_result(retVal, ppCall), pState->cache, err);
+			}
+
+			inline bool invoke_typed(paramparser & parser, void * pResult, std::type_info const & type, invoker_error & err) const
+			{
+				typedef typename memo_state<Binder>::cache_type::value_type value_type;
+
+				if(type != typeid(value_type))
+				{
+					err.code = invoker_result_mismatch;
+					return false;
+				}
+
+				typed_result<value_type> sink = {static_cast<value_type*>(pResult)};
+				return pState->binder.apply_memo(parser, sink, pState->cache, err);
+			}
+
+			// a compiled command has its arguments already, it calls the function directly
+			inline compiled_command* compile(paramparser & parser) const
+			{
+				return pState->binder.compile(parser);
+			}
+
+			// a batch has distinct rows usually, it isn't worth a lookup per row
+			inline bool apply_batch(batch_args const & batch, invoker_error & err) const
+			{
+				return pState->binder.apply_batch(batch, err);
+			}
+		};
+
+		/**
+		* The function with its converted arguments, the object is void for a non-member function.
+		* CallArgs refers to the stored arguments except a non-const or an rvalue reference parameter,
+		* it gets a copy for every call so a replay always sees the compiled argument. Params is the
+		* std::tuple of the parameter types.
+		*/
+		template<typename Function, typename TheClass, typename Args, typename CallArgs, typename Params>
+		struct bound_command : compiled_command
+		{
+			Function func;
+			TheClass* theclass;
+			Args args;
+
+			bound_command(Function f, TheClass* obj, Args&& a) : func(f), theclass(obj), args(std::move(a))
+			{ }
+
+			virtual InvokerR call() const
+			{
+				return call(std::make_index_sequence<std::tuple_size<Args>::value>());
+			}
+
+			template<size_t... Is>
+			inline InvokerR call(std::index_sequence<Is...>) const
+			{
+				InvokerR retVal;
+				CallArgs call_args(std::get<Is>(args)...);
+				(void)call_args; //a function without parameters doesn't use it
+
+				take_result(detail::callable_invoke(func, theclass,
+					detail::pass_arg<typename std::tuple_element<Is, Params>::type, typename std::tuple_element<Is, CallArgs>::type>(std::get<Is>(call_args))...), retVal, NULL);
+				return retVal;
+			}
 		};
 
-		template<> InvokerR parse_input<char const*>(char const* const & szText)
+		// the future of an asynchronous function
+		template<typename Future>
+		struct future_call : pending_call
 		{
-			return parse_input(std::string(szText));
-		};
+			Future result;
 
-	private:
-		template< typename Function
-			, class Argstype_From = typename mpl::begin< ft::parameter_types<Function> >::type
-			, class Argstype_To   = typename mpl::end< ft::parameter_types<Function> >::type
-		>
-		struct invoker;
+			explicit future_call(Future&& f) : result(std::move(f))
+			{ }
+
+			explicit future_call(Future const& f) : result(f)
+			{ }
+
+			virtual InvokerR get()
+			{
+				InvokerR retVal = result.get();
+				return retVal;
+			}
+		};
 	};
 
 	template< typename tokenIter>
@@ -284,8 +2079,10 @@ namespace DT
 			}
 		};
 
-		// if the iterator is string, use boost::lexical_cast otherwise use the type conversion operator
-		template<typename Target, typename Source>
+		// if the iterator is string, use token_cast otherwise use the type conversion operator.
+		// The string specializations overlap the "T from T" ones, the Dummy parameter keeps the
+		// specializations for the overlapped cases partial so they can be declared in the class.
+		template<typename Target, typename Source, typename Dummy = void>
 		struct type_cast
 		{
 			typedef Target result_type;
@@ -297,8 +2094,8 @@ namespace DT
 		};
 
 		//type cast like T from T
-		template<typename Source>
-		struct type_cast<Source, Source>
+		template<typename Source, typename Dummy>
+		struct type_cast<Source, Source, Dummy>
 		{
 			typedef Source result_type;
 
@@ -309,10 +2106,10 @@ namespace DT
 		};
 
 		//type cast like T& T from T
-		template<typename Source>
-		struct type_cast<typename std::add_reference<Source>::type, Source>
+		template<typename Source, typename Dummy>
+		struct type_cast<Source&, Source, Dummy>
 		{
-			typedef typename add_reference<Source>::type result_type;
+			typedef Source& result_type;
 
 			static inline result_type apply(Source & obj)
 			{
@@ -321,10 +2118,10 @@ namespace DT
 		};
 
 		//type cast like T* from T
-		template<typename Source>
-		struct type_cast<typename std::add_pointer<Source>::type, Source>
+		template<typename Source, typename Dummy>
+		struct type_cast<Source*, Source, Dummy>
 		{
-			typedef typename add_pointer<Source>::type result_type;
+			typedef Source* result_type;
 
 			static inline result_type apply(Source & obj)
 			{
@@ -332,50 +2129,196 @@ namespace DT
 			}
 		};
 		
-		//if the source is string, using the lexical_cast. then need 
+		//if the source is string, using the token_cast. then need 
 		//remove the reference &. 
-		template<typename Target>
-		struct type_cast<Target, std::string>
+		template<typename Target, typename Dummy>
+		struct type_cast<Target, std::string, Dummy>
 		{
 			typedef typename remove_cv_ref<Target>::type result_type;
 				
-			static inline result_type apply(std::string & obj)
+			static inline result_type apply(std::string const& obj)
 			{
-				return boost::lexical_cast<result_type>(obj.c_str());
+				return token_cast<result_type>(obj.data(), obj.data() + obj.size());
 			}
 		};
 
-		template<typename Target>
-		struct type_cast<Target, std::wstring>
+		template<typename Target, typename Dummy>
+		struct type_cast<Target, std::wstring, Dummy>
 		{
 			typedef typename remove_cv_ref<Target>::type result_type;
 				
-			static inline result_type apply(std::wstring & obj)
+			static inline result_type apply(std::wstring const& obj)
+			{
+				return token_cast<result_type>(obj.data(), obj.data() + obj.size());
+			}
+		};
+
+		//the string token itself, just copy it like the other string conversions
+		template<typename Dummy>
+		struct type_cast<std::string, std::string, Dummy>
+		{
+			typedef std::string result_type;
+
+			static inline result_type apply(std::string const& obj)
+			{
+				return obj;
+			}
+		};
+
+		template<typename Dummy>
+		struct type_cast<std::string&, std::string, Dummy> : type_cast<std::string, std::string, Dummy>
+		{
+		};
+
+		template<typename Dummy>
+		struct type_cast<std::wstring, std::wstring, Dummy>
+		{
+			typedef std::wstring result_type;
+
+			static inline result_type apply(std::wstring const& obj)
+			{
+				return obj;
+			}
+		};
+
+		template<typename Dummy>
+		struct type_cast<std::wstring&, std::wstring, Dummy> : type_cast<std::wstring, std::wstring, Dummy>
+		{
+		};
+
+		//the function name is always read as a narrow string
+		template<typename Dummy>
+		struct type_cast<std::string, std::wstring, Dummy>
+		{
+			typedef std::string result_type;
+
+			static inline result_type apply(std::wstring const& obj)
+			{
+				return std::string(obj.begin(), obj.end());
+			}
+		};
+
+#ifdef __cpp_lib_string_view
+		//the token is a view into the input, convert it without copying the token
+		template<typename Target, typename Char, typename Dummy>
+		struct type_cast<Target, std::basic_string_view<Char>, Dummy>
+		{
+			typedef typename remove_cv_ref<Target>::type result_type;
+
+			static inline result_type apply(std::basic_string_view<Char> const& obj)
+			{
+				return token_view_cast<result_type, Char>::apply(obj);
+			}
+		};
+
+		template<typename Char, typename Dummy>
+		struct type_cast<std::basic_string_view<Char>, std::basic_string_view<Char>, Dummy>
+			: type_cast<std::basic_string_view<Char> const, std::basic_string_view<Char>, Dummy>
+		{
+		};
+
+		template<typename Char, typename Dummy>
+		struct type_cast<std::basic_string_view<Char>&, std::basic_string_view<Char>, Dummy>
+			: type_cast<std::basic_string_view<Char> const, std::basic_string_view<Char>, Dummy>
+		{
+		};
+#endif
+
+		// the non-throwing conversion of try_get(). Only a text token can be invalid, the strings
+		// and the views are taken as they are, the other types go to try_token_cast
+		template<typename Target, typename Token>
+		struct text_try_cast
+		{
+			typedef type_cast<Target, Token> type_castor;
+			typedef typename type_castor::result_type result_type;
+
+			static inline result_type apply(Token const& obj, bool & bOk)
+			{
+				return apply(obj, bOk, is_token_text<result_type>());
+			}
+
+			static inline result_type apply(Token const& obj, bool & bOk, std::true_type)
+			{
+				bOk = true;
+				return type_castor::apply(obj);
+			}
+
+			static inline result_type apply(Token const& obj, bool & bOk, std::false_type)
+			{
+				result_type value = result_type();
+				bOk = try_token_cast(obj.data(), obj.data() + obj.size(), value);
+				return value;
+			}
+		};
+
+		// the other tokens use the type conversion operator, it doesn't fail
+		template<typename Target, typename Source, typename Dummy = void>
+		struct type_try_cast
+		{
+			typedef type_cast<Target, Source> type_castor;
+			typedef typename type_castor::result_type result_type;
+
+			static inline result_type apply(Source & obj, bool & bOk)
 			{
-				return boost::lexical_cast<result_type>(obj.c_str());
+				bOk = true;
+				return type_castor::apply(obj);
 			}
 		};
+
+		template<typename Target, typename Char, typename Dummy>
+		struct type_try_cast<Target, std::basic_string<Char>, Dummy> : text_try_cast<Target, std::basic_string<Char> >
+		{
+		};
+
+#ifdef __cpp_lib_string_view
+		template<typename Target, typename Char, typename Dummy>
+		struct type_try_cast<Target, std::basic_string_view<Char>, Dummy> : text_try_cast<Target, std::basic_string_view<Char> >
+		{
+		};
+#endif
 		
 	public:
+		/** \throw std::runtime_error if the token isn't a valid RequestedType */
 		template<typename RequestedType>
 		typename type_cast<RequestedType, tokentype>::result_type
 		get()
 		{
-			if (!this->has_more_tokens())
-				return type_cast<RequestedType, tokentype>::result_type();
-			else
+			bool bOk = false;
+
+			try
 			{
-				try
-				{
-					typedef type_cast<RequestedType, tokentype> type_castor;
-					type_castor::result_type result = type_castor::apply(*(this->itr_at));
-				
-					++(this->itr_at);
+				typename type_cast<RequestedType, tokentype>::result_type result = try_get<RequestedType>(bOk);
+
+				if(bOk)
 					return result;
-				}
-				catch (std::exception &)
-				{ throw std::runtime_error("invalid argument: " + std::string(typeid(*this->itr_at).name())); }
 			}
+			catch (std::exception &)
+			{ }
+
+			throw std::runtime_error("invalid argument: " + std::string(typeid(*this->itr_at).name()));
+		}
+
+		/**
+		* Get the next argument without throwing. bOk is false if the token isn't a valid 
+		* RequestedType, the parser stays at the token then. The missing argument is the default
+		* value, like get().
+		*/
+		template<typename RequestedType>
+		typename type_cast<RequestedType, tokentype>::result_type
+		try_get(bool & bOk)
+		{
+			bOk = true;
+
+			if (!this->has_more_tokens())
+				return typename type_cast<RequestedType, tokentype>::result_type();
+
+			typedef type_try_cast<RequestedType, tokentype> type_castor;
+			typename type_castor::result_type result = type_castor::apply(*(this->itr_at), bOk);
+
+			if(bOk)
+				++(this->itr_at);
+
+			return result;
 		}
 
 		// Any more tokens?
@@ -385,42 +2328,339 @@ namespace DT
 		token_iterator itr_at, itr_to;
 	};
 
+	template<>
+	struct param_parser_factory<std::string, interpreter_param_parser< boost::token_iterator_generator< boost::char_separator<char> >::type >>
+	{
+		typedef interpreter_param_parser< boost::token_iterator_generator< boost::char_separator<char> >::type > result_type;
+
+		static inline result_type make(std::string const& text)
+		{
+			boost::char_separator<char> s(" \t\n\r");
+
+			return result_type(boost::make_token_iterator<std::string>(text.begin(), text.end(), s),
+				boost::make_token_iterator<std::string>(text.end()  , text.end(), s));
+		}
+	};
+
+	template<>
+	struct param_parser_factory<std::wstring, interpreter_param_parser< boost::token_iterator_generator< boost::char_separator<wchar_t>, std::wstring::const_iterator, std::wstring >::type >>
+	{
+		typedef interpreter_param_parser< boost::token_iterator_generator< boost::char_separator<wchar_t>, std::wstring::const_iterator, std::wstring >::type > result_type;
+
+		static inline result_type make(std::wstring const& text)
+		{
+			boost::char_separator<wchar_t> s(L" \t\n\r");
+
+			return result_type(boost::make_token_iterator<std::wstring>(text.begin(), text.end(), s),
+				boost::make_token_iterator<std::wstring>(text.end()  , text.end(), s));
+		}
+	};
+
+	template<typename Char>
+	struct param_parser_factory<token_stream<Char>, interpreter_param_parser< token_stream_iterator<Char> > >
+	{
+		typedef interpreter_param_parser< token_stream_iterator<Char> > result_type;
+
+		static inline result_type make(token_stream<Char> const& input)
+		{
+			return result_type(token_stream_iterator<Char>(input), token_stream_iterator<Char>());
+		}
+	};
+
+#ifdef __cpp_lib_string_view
+	template<typename Char, typename Traits, typename Alloc>
+	struct param_parser_factory<std::basic_string<Char,Traits,Alloc>, interpreter_param_parser< token_view_iterator<Char> > >
+	{
+		typedef interpreter_param_parser< token_view_iterator<Char> > result_type;
+
+		static inline result_type make(std::basic_string<Char,Traits,Alloc> const& text)
+		{
+			Char const* pEnd = text.data() + text.size();
+
+			return result_type(token_view_iterator<Char>(text.data(), pEnd), token_view_iterator<Char>(pEnd, pEnd));
+		}
+	};
+
+	template<typename Char, typename Traits>
+	struct param_parser_factory<std::basic_string_view<Char,Traits>, interpreter_param_parser< token_view_iterator<Char> > >
+	{
+		typedef interpreter_param_parser< token_view_iterator<Char> > result_type;
+
+		static inline result_type make(std::basic_string_view<Char,Traits> const& text)
+		{
+			Char const* pEnd = text.data() + text.size();
+
+			return result_type(token_view_iterator<Char>(text.data(), pEnd), token_view_iterator<Char>(pEnd, pEnd));
+		}
+	};
+#endif
+
+	/**
+	* The invoker of a function with the parameters Params. The arguments are read in the parameter
+	* order into a tuple by one pack expansion, then the function is called with the tuple
+	* elements. Nothing is instantiated per argument except the parser's get() for the type, so
+	* the arity isn't limited and the compile time grows linearly with it.
+	*/
 	template<typename paramparser, typename InvokerR,typename Hasher>
-	template<typename Function, class Argstype_From, class Argstype_To>
-	struct interpreter<paramparser,InvokerR,Hasher>::invoker
+	template<typename Function, typename... Params>
+	struct interpreter<paramparser,InvokerR,Hasher>::invoker< Function, type_list<Params...> >
 	{
-		typedef typename mpl::deref<Argstype_From>::type arg_type;
-		typedef typename mpl::next<Argstype_From>::type next_iter_type;
-		typedef typename invoker<Function,next_iter_type,Argstype_To>::result_type result_type;
+		typedef typename callable_traits<Function>::result_type result_type;
 
-		// add an argument to a Fusion cons-list for each parameter type
-		template<typename Args>
-		static inline InvokerR apply(Function func, paramparser & parser, Args & args)
-		{			
-			return invoker<Function, next_iter_type, Argstype_To>::apply( func, parser, fusion::push_back(args, parser.get<arg_type>()) );
+		// the type read for the parameter, it may be a reference into the parser
+		template<typename Param>
+		struct arg_result
+		{
+			typedef decltype(detail::parser_try_get<Param>(std::declval<paramparser&>(), std::declval<bool&>(), 0)) type;
 		};
 
-		template<typename Args, typename theClass>
-		static inline InvokerR apply(Function func, theClass* theclass, paramparser & parser, Args & args)
+		// the type kept by a compiled command for the parameter
+		template<typename Param>
+		struct arg_value
 		{
-			typedef fusion::result_of::push_back<Args const,theClass*>::type SeqType;
-			return invoker<Function, next_iter_type, Argstype_To>::apply<SeqType>( func, parser, fusion::push_back(args, theclass));
+			typedef typename std::decay<decltype(std::declval<paramparser&>().template get<Param>())>::type type;
 		};
-	};
 
-	template<typename paramparser, typename InvokerR,typename Hasher>
-	template<typename Function, class Argstype_To>
-	struct interpreter<paramparser,InvokerR,Hasher>::invoker<Function,Argstype_To,Argstype_To>
-	{ 
-		typedef typename boost::function_types::result_type<Function>::type result_type;
+		// the parameter gets a copy of the kept argument, i.e. a non-const or an rvalue reference
+		template<typename Param>
+		struct is_copied_param
+		{
+			typedef typename std::remove_reference<Param>::type param_type;
+
+			static const bool value = std::is_rvalue_reference<Param>::value || (std::is_lvalue_reference<Param>::value && !std::is_const<param_type>::value);
+		};
 
-		// the argument list is complete, now call the function
-		template<typename Args>
-		static inline InvokerR apply(Function func, paramparser &, Args const & args)
+		// the argument passed by a compiled command, a copy for a non-const or an rvalue reference parameter
+		template<typename Param>
+		struct arg_call
 		{
-			InvokerR retVal = fusion::invoke(func,args);
-			return retVal;
+			typedef typename std::conditional<is_copied_param<Param>::value,
+				typename arg_value<Param>::type, typename arg_value<Param>::type const&>::type type;
+		};
+
+		/**
+		* A compiled command or a batch keeps its arguments and passes them again on every call, so
+		* every argument but of a const reference parameter must be copy constructible.
+		*/
+		static const bool is_replayable = !detail::any_of<(!std::is_copy_constructible<typename arg_value<Params>::type>::value
+			&& !(std::is_lvalue_reference<Params>::value && std::is_const<typename std::remove_reference<Params>::type>::value))...>::value;
+
+		/**
+		* Read the arguments in order. After an invalid argument the rest isn't read, the skipped 
+		* ones are the default value and the function isn't called.
+		*/
+		struct arg_reader
+		{
+			paramparser & parser;
+			bool bOk;
+			size_t nFailed;
+
+			explicit arg_reader(paramparser & p) : parser(p), bOk(true), nFailed(0)
+			{ }
+
+			template<typename Param>
+			inline typename arg_result<Param>::type read(size_t nIndex)
+			{
+				typedef typename arg_result<Param>::type value_type;
+
+				if(!bOk)
+					return skipped<value_type>(std::is_reference<value_type>());
+
+				value_type value = detail::parser_try_get<Param>(parser, bOk, 0);
+
+				if(!bOk)
+					nFailed = nIndex;
+
+				return value;
+			}
+
+			template<typename T>
+			static inline T skipped(std::false_type)
+			{
+				return T();
+			}
+
+			// a reference needs an object, it is never used because the function isn't called
+			template<typename T>
+			static inline T skipped(std::true_type)
+			{
+				static typename std::remove_reference<T>::type unused;
+				return unused;
+			}
 		};
+
+		/** read the arguments, call the function and hand its result to the sink */
+		template<typename TheClass, typename ResultSink>
+		static inline bool apply(Function func, TheClass* theclass, paramparser & parser, ResultSink const & sink, invoker_error & err)
+		{
+			return apply(func, theclass, parser, sink, err, std::index_sequence_for<Params...>());
+		}
+
+		template<typename TheClass>
+		static inline bool apply_typed(Function func, TheClass* theclass, paramparser & parser, void * pResult, std::type_info const & type, invoker_error & err)
+		{
+			typedef typename detail::result_value<result_type>::type value_type;
+
+			if(type != typeid(value_type))
+			{
+				err.code = invoker_result_mismatch;
+				return false;
+			}
+
+			typed_result<value_type> sink = {static_cast<value_type*>(pResult)};
+			return apply(func, theclass, parser, sink, err, std::index_sequence_for<Params...>());
+		}
+
+		// the braced list is evaluated from left to right, so the arguments are read in order
+		template<typename TheClass, typename ResultSink, size_t... Is>
+		static inline bool apply(Function func, TheClass* theclass, paramparser & parser, ResultSink const & sink, invoker_error & err, std::index_sequence<Is...>)
+		{
+			arg_reader reader(parser);
+			std::tuple<typename arg_result<Params>::type...> args{ reader.template read<Params>(Is)... };
+
+			if(!reader.bOk)
+			{
+				err.code = invoker_invalid_argument;
+				err.arg_index = reader.nFailed;
+				return false;
+			}
+
+			sink(detail::callable_invoke(func, theclass, detail::pass_arg<Params, typename arg_result<Params>::type>(std::get<Is>(args))...));
+			return true;
+		}
+
+		// the argument of a batch row, a copy for a non-const or an rvalue reference parameter
+		template<typename Param>
+		struct batch_call
+		{
+			typedef typename std::decay<Param>::type column_type;
+			typedef typename std::conditional<is_copied_param<Param>::value, column_type, column_type const&>::type type;
+		};
+
+		/**
+		* Call the function for every row of the columns into the output. The types are checked once,
+		* then the loop has no dispatch or parsing per row.
+		*/
+		template<typename TheClass>
+		static inline bool apply_batch(Function func, TheClass* theclass, batch_args const & batch, invoker_error & err)
+		{
+			return apply_batch(func, theclass, batch, err, std::integral_constant<bool, is_replayable>());
+		}
+
+		// a column of a move-only type can't be passed without moving the elements out of it
+		template<typename TheClass>
+		static inline bool apply_batch(Function, TheClass*, batch_args const &, invoker_error & err, std::false_type)
+		{
+			err.code = invoker_argument_mismatch;
+			err.arg_index = 0;
+			return false;
+		}
+
+		template<typename TheClass>
+		static inline bool apply_batch(Function func, TheClass* theclass, batch_args const & batch, invoker_error & err, std::true_type)
+		{
+			typedef typename detail::result_value<result_type>::type value_type;
+			std::type_info const* types[] = { &typeid(void), &typeid(typename batch_call<Params>::column_type)... };
+
+			if(*batch.pOutType != typeid(value_type))
+			{
+				err.code = invoker_result_mismatch;
+				return false;
+			}
+
+			for(size_t i = 0; i < sizeof...(Params) || i < batch.nColumns; i++)
+			{
+				if(i >= sizeof...(Params) || i >= batch.nColumns || *batch.ppTypes[i] != *types[i + 1])
+				{
+					err.code = invoker_argument_mismatch;
+					err.arg_index = i;
+					return false;
+				}
+			}
+
+			apply_rows(func, theclass, batch.ppColumns, batch.nRows, static_cast<value_type*>(batch.pOut), std::index_sequence_for<Params...>());
+			return true;
+		}
+
+		template<typename TheClass, typename Value, size_t... Is>
+		static inline void apply_rows(Function func, TheClass* theclass, void const* const* ppColumns, size_t nRows, Value* pOut, std::index_sequence<Is...>)
+		{
+			std::tuple<typename batch_call<Params>::column_type const*...> columns(static_cast<typename batch_call<Params>::column_type const*>(ppColumns[Is])...);
+			(void)columns; //a function without parameters doesn't use it
+
+			for(size_t nRow = 0; nRow < nRows; nRow++)
+			{
+				std::tuple<typename batch_call<Params>::type...> row(std::get<Is>(columns)[nRow]...);
+				(void)row;
+				typed_result<Value> sink = {pOut + nRow};
+
+				sink(detail::callable_invoke(func, theclass, detail::pass_arg<Params, typename batch_call<Params>::type>(std::get<Is>(row))...));
+			}
+		}
+
+		// a pure function returns a value to be cached and doesn't take a non-const reference
+		static const bool is_memo_result = !std::is_void<result_type>::value && !is_async_result<typename std::decay<result_type>::type>::value;
+		static const bool is_memo_params = !detail::any_of<(std::is_lvalue_reference<Params>::value && !std::is_const<typename std::remove_reference<Params>::type>::value)...>::value;
+
+		typedef std::tuple<typename detail::memo_key<typename arg_value<Params>::type>::type...> memo_key_type;
+		typedef memo_cache<memo_key_type, typename std::decay<result_type>::type, tuple_hash<memo_key_type> > memo_cache_type;
+
+		/** apply() of a pure function, the cached result is handed to the sink instead of calling it */
+		template<typename TheClass, typename ResultSink>
+		static inline bool apply_memo(Function func, TheClass* theclass, paramparser & parser, ResultSink const & sink, memo_cache_type & cache, invoker_error & err)
+		{
+			return apply_memo(func, theclass, parser, sink, cache, err, std::index_sequence_for<Params...>());
+		}
+
+		template<typename TheClass, typename ResultSink, size_t... Is>
+		static inline bool apply_memo(Function func, TheClass* theclass, paramparser & parser, ResultSink const & sink, memo_cache_type & cache, invoker_error & err, std::index_sequence<Is...>)
+		{
+			arg_reader reader(parser);
+			std::tuple<typename arg_result<Params>::type...> args{ reader.template read<Params>(Is)... };
+
+			if(!reader.bOk)
+			{
+				err.code = invoker_invalid_argument;
+				err.arg_index = reader.nFailed;
+				return false;
+			}
+
+			memo_key_type key(std::get<Is>(args)...);
+
+			if(cache.visit(key, sink))
+				return true;
+
+			typename memo_cache_type::value_type value(detail::callable_invoke(func, theclass, detail::pass_arg<Params, typename arg_result<Params>::type>(std::get<Is>(args))...));
+
+			cache.insert(std::move(key), value);
+			sink(std::move(value));
+
+			return true;
+		}
+
+		// the same argument parsing as apply(), but keep the arguments for a compiled program
+		template<typename TheClass>
+		static inline compiled_command* compile(Function func, TheClass* theclass, paramparser & parser)
+		{
+			return compile(func, theclass, parser, std::integral_constant<bool, is_replayable>());
+		}
+
+		template<typename TheClass>
+		static inline compiled_command* compile(Function, TheClass*, paramparser &, std::false_type)
+		{
+			throw std::runtime_error("the function takes a move-only argument, it can't be compiled");
+		}
+
+		template<typename TheClass>
+		static inline compiled_command* compile(Function func, TheClass* theclass, paramparser & parser, std::true_type)
+		{
+			typedef std::tuple<typename arg_value<Params>::type...> arg_values;
+			typedef std::tuple<typename arg_call<Params>::type...> call_args;
+
+			arg_values args{ parser.template get<Params>()... };
+
+			return new bound_command<Function, TheClass, arg_values, call_args, std::tuple<Params...> >(func, theclass, std::move(args));
+		}
 	};
 
 	template<typename T, typename I, size_t N = boost::fusion::tuple_size<T>::value>
@@ -434,13 +2674,11 @@ namespace DT
 		*/
 		static T parse(T& val, I& token, size_t nLevels = -1)
 		{
-			try
-			{
-				get<boost::fusion::tuple_size<T>::value - N>(val) = boost::lexical_cast<boost::fusion::tuple_element<boost::fusion::tuple_size<T>::value - N,T>::type>(*token);
-			}
-			catch(boost::bad_lexical_cast e)
-			{
-			}
+			typename boost::fusion::tuple_element<boost::fusion::tuple_size<T>::value - N,T>::type value;
+
+			//the invalid token leaves the element unchanged
+			if(boost::conversion::try_lexical_convert(*token, value))
+				get<boost::fusion::tuple_size<T>::value - N>(val) = value;
 
 			token++;
 			nLevels--;
@@ -457,13 +2695,10 @@ namespace DT
 	{
 		static T parse(T& val, I& token, size_t nLevels)
 		{
-			try
-			{
-				get<boost::fusion::tuple_size<T>::value - 1>(val) = boost::lexical_cast<boost::fusion::tuple_element<boost::fusion::tuple_size<T>::value - 1,T>::type>(*token);
-			}
-			catch(boost::bad_lexical_cast e)
-			{
-			}
+			typename boost::fusion::tuple_element<boost::fusion::tuple_size<T>::value - 1,T>::type value;
+
+			if(boost::conversion::try_lexical_convert(*token, value))
+				get<boost::fusion::tuple_size<T>::value - 1>(val) = value;
 
 			return val;
 		}
@@ -475,13 +2710,12 @@ template<typename T, size_t N = boost::fusion::tuple_size<T>::value>
 	{
 		static void create(T& val, wstring &outString, wstring delim=L";")
 		{
-			try
+			wstring strValue;
+
+			if(boost::conversion::try_lexical_convert(get<boost::fusion::tuple_size<T>::value - N>(val), strValue))
 			{
-				outString.append(boost::lexical_cast<wstring>(get<boost::fusion::tuple_size<T>::value - N>(val)));
+				outString.append(strValue);
 				outString.append(delim);
-			}
-			catch(boost::bad_lexical_cast e)
-			{
 			}
 
 			 make_String<T,N-1>::create(val,outString, delim);
@@ -493,13 +2727,10 @@ template<typename T, size_t N = boost::fusion::tuple_size<T>::value>
 	{
 		static void create(T& val, wstring& outString, wstring delim=L";")
 		{
-			try
-			{
-				outString.append(boost::lexical_cast<wstring>(get<boost::fusion::tuple_size<T>::value - 1>(val)));
-			}
-			catch(boost::bad_lexical_cast e)
-			{
-			}
+			wstring strValue;
+
+			if(boost::conversion::try_lexical_convert(get<boost::fusion::tuple_size<T>::value - 1>(val), strValue))
+				outString.append(strValue);
 		}
 	};
 
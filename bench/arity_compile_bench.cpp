@@ -0,0 +1,80 @@
+/**
+ * (C) Copyright 2013 Dreamer
+ *
+ * this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+* The translation unit compiled by arity_compile_bench.sh. It registers DT_BENCH_FUNCTIONS
+* functions of DT_BENCH_ARITY int parameters and calls them through parse_input() and a
+* compiled program, so every invoker path is instantiated.
+*/
+
+#include <string>
+#include <utility>
+
+#include "Interpreter.hpp"
+
+#ifndef DT_BENCH_ARITY
+#define DT_BENCH_ARITY 10
+#endif
+
+#ifndef DT_BENCH_FUNCTIONS
+#define DT_BENCH_FUNCTIONS 4
+#endif
+
+template<size_t I>
+struct int_param
+{
+	typedef int type;
+};
+
+// Tag makes every registered function another instantiation
+template<size_t Tag, size_t... Is>
+int sum_args(typename int_param<Is>::type... args)
+{
+	int nSum = (int)Tag;
+	int dummy[] = {0, (nSum += args, 0)...};
+
+	(void)dummy;
+	return nSum;
+}
+
+template<size_t Tag, size_t... Is>
+auto arity_function(std::index_sequence<Is...>) -> int (*)(typename int_param<Is>::type...)
+{
+	return &sum_args<Tag, Is...>;
+}
+
+template<size_t... Tags>
+void register_functions(DT::interpreter<> & interp, std::index_sequence<Tags...>)
+{
+	int dummy[] = {0, (interp.register_function("fn" + std::to_string(Tags), arity_function<Tags>(std::make_index_sequence<DT_BENCH_ARITY>())), 0)...};
+
+	(void)dummy;
+}
+
+int main()
+{
+	DT::interpreter<> interp;
+	register_functions(interp, std::make_index_sequence<DT_BENCH_FUNCTIONS>());
+
+	std::string strCommand = "fn0";
+	for(int i = 0; i < DT_BENCH_ARITY; i++)
+		strCommand += " " + std::to_string(i);
+
+	int nTotal = DT::any_cast<int>(interp.parse_input(strCommand));
+	nTotal += DT::any_cast<int>(interp.execute(interp.compile(strCommand)));
+
+	return nTotal == DT_BENCH_ARITY * (DT_BENCH_ARITY - 1) ? 0 : 1;
+}
@@ -0,0 +1,44 @@
+#!/bin/sh
+#
+# (C) Copyright 2013 Dreamer
+#
+# this file to You under the Apache License, Version 2.0
+# (the "License"); you may not use this file except in compliance with
+# the License.  You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+# Report the build time and the object size of arity_compile_bench.cpp by the arity of the
+# registered functions. The compiler and the flags come from CXX and CXXFLAGS, the arities
+# from the arguments (10 50 100 by default). The objects are written to the current directory.
+#
+#     CXXFLAGS="-O2 -I/path/to/DTLibrary" bench/arity_compile_bench.sh 10 50 100
+
+CXX=${CXX:-c++}
+CXXFLAGS=${CXXFLAGS:--O2}
+SOURCE=$(dirname "$0")/arity_compile_bench.cpp
+
+if [ $# -eq 0 ]; then
+	set -- 10 50 100
+fi
+
+printf "%6s %12s %14s\n" "arity" "build ms" "object bytes"
+
+for ARITY in "$@"; do
+	OBJECT=arity_compile_bench_$ARITY.o
+	START=$(date +%s%N)
+
+	if ! $CXX -std=c++17 $CXXFLAGS -DDT_BENCH_ARITY=$ARITY -c "$SOURCE" -o "$OBJECT"; then
+		echo "arity $ARITY doesn't compile" >&2
+		exit 1
+	fi
+
+	END=$(date +%s%N)
+	printf "%6s %12s %14s\n" "$ARITY" $(( (END - START) / 1000000 )) $(wc -c < "$OBJECT")
+done
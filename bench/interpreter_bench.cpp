@@ -0,0 +1,546 @@
+/**
+ * (C) Copyright 2013 Dreamer
+ *
+ * this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+* The interpreter benchmark suite. It reports
+*	1. the dispatch latency by the number of the registered functions
+*	2. the cost per argument from arity 0 to DT_BENCH_MAX_ARITY
+*	3. the tokenize and convert throughput of the narrow and the wide parsers
+*	4. the heap allocations per call
+*	5. the cost per row of a batch over the argument columns
+*	6. the parse_input latency of the repeated command lines with and without the parse cache
+*	7. the latency of two chained commands, through the text or through a typed pipeline
+*	8. the latency of a call by the text arguments and by the binary arguments
+*	9. the cost per call of the JSON-RPC requests, alone and in a batch
+*
+* The optional argument scales the iteration counts, e.g. "interpreter_bench 0.1" for a quick run.
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <string>
+#include <sstream>
+#include <vector>
+#include <utility>
+#include <new>
+
+#include "Interpreter.hpp"
+#include "binary_params.hpp"
+#include "json_rpc.hpp"
+
+#ifndef DT_BENCH_MAX_ARITY
+#define DT_BENCH_MAX_ARITY 32
+#endif
+
+static size_t g_nAllocs = 0;
+static double g_dScale = 1.0;
+volatile int g_sink = 0;
+
+void* operator new(size_t size)
+{
+	g_nAllocs++;
+
+	if(void* p = std::malloc(size ? size : 1))
+		return p;
+
+	throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+	std::free(p);
+}
+
+// hands out the same value for every parameter, so only the dispatch and the invoker are measured
+struct constant_parser
+{
+	int value;
+
+	template<typename T> T get() { return T(value); }
+	bool has_more_tokens() const { return false; }
+};
+
+template<size_t I>
+struct int_param
+{
+	typedef int type;
+};
+
+template<size_t... Is>
+int sum_args(typename int_param<Is>::type... args)
+{
+	int nSum = 0;
+	int dummy[] = {0, (nSum += args, 0)...};
+
+	(void)dummy;
+	return nSum;
+}
+
+template<size_t... Is>
+auto arity_function(std::index_sequence<Is...>) -> int (*)(typename int_param<Is>::type...)
+{
+	return &sum_args<Is...>;
+}
+
+inline size_t iterations(size_t nBase)
+{
+	size_t nCount = (size_t)(nBase * g_dScale);
+	return nCount > 0 ? nCount : 1;
+}
+
+template<typename Body>
+double ns_per_iteration(size_t nCount, Body const& body)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	for(size_t i = 0; i < nCount; i++)
+		body(i);
+
+	std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+	return elapsed.count() / nCount;
+}
+
+template<typename Body>
+double allocs_per_iteration(size_t nCount, Body const& body)
+{
+	size_t nAllocs = g_nAllocs;
+
+	for(size_t i = 0; i < nCount; i++)
+		body(i);
+
+	return (double)(g_nAllocs - nAllocs) / nCount;
+}
+
+void bench_dispatch()
+{
+	typedef DT::interpreter<constant_parser, int> interpreter_type;
+	const size_t counts[] = {1, 16, 256, 4096, 65536};
+
+	std::printf("\n1. dispatch latency by registered functions\n");
+	std::printf("%10s %14s %14s\n", "functions", "ns/call", "frozen ns/call");
+
+	for(size_t n = 0; n < sizeof(counts) / sizeof(counts[0]); n++)
+	{
+		interpreter_type interp;
+		std::vector<size_t> ids;
+
+		for(size_t i = 0; i < counts[n]; i++)
+			ids.push_back(interp.register_function("fn" + std::to_string(i), &sum_args<0, 1>));
+
+		// visit the functions in a scattered order so the lookup isn't always cache hot
+		const size_t nCalls = iterations(10000000);
+		constant_parser parser = {1};
+		int nTotal = 0;
+
+		double dMap = ns_per_iteration(nCalls, [&](size_t i) { nTotal += interp.ExecInvoker(ids[(i * 7919) % ids.size()], parser); });
+		interp.freeze();
+		double dFrozen = ns_per_iteration(nCalls, [&](size_t i) { nTotal += interp.ExecInvoker(ids[(i * 7919) % ids.size()], parser); });
+
+		g_sink = nTotal;
+		std::printf("%10u %14.2f %14.2f\n", (unsigned)counts[n], dMap, dFrozen);
+	}
+}
+
+template<size_t N>
+void bench_one_arity()
+{
+	typedef DT::interpreter<constant_parser, int> constant_interpreter;
+	typedef DT::interpreter<DT::interpreter<>::_string_view_param_parser, int> text_interpreter;
+
+	constant_interpreter interp;
+	size_t fnID = interp.register_function("fn", arity_function(std::make_index_sequence<N>()));
+	interp.freeze();
+
+	text_interpreter text_interp;
+	text_interp.register_function("fn", arity_function(std::make_index_sequence<N>()));
+	text_interp.freeze();
+
+	std::string strCommand = "fn";
+	for(size_t i = 0; i < N; i++)
+		strCommand += " " + std::to_string(i * 37);
+
+	const size_t nCalls = iterations(2000000);
+	constant_parser parser = {1};
+	int nTotal = 0;
+
+	double dDispatch = ns_per_iteration(nCalls, [&](size_t) { nTotal += interp.ExecInvoker(fnID, parser); });
+	double dText = ns_per_iteration(nCalls / 4, [&](size_t) { nTotal += text_interp.parse_input(strCommand); });
+
+	g_sink = nTotal;
+	std::printf("%6u %16.2f %16.2f\n", (unsigned)N, dDispatch, dText);
+}
+
+template<size_t... Ns>
+void bench_arity(std::index_sequence<Ns...>)
+{
+	std::printf("\n2. cost by arity (int parameters)\n");
+	std::printf("%6s %16s %16s\n", "arity", "dispatch ns", "parse_input ns");
+
+	int dummy[] = {0, (bench_one_arity<Ns>(), 0)...};
+	(void)dummy;
+}
+
+int add(int a, int b)
+{
+	return a + b;
+}
+
+int square(int x)
+{
+	return x * x;
+}
+
+// the argument is taken by value, it is moved in from the converted argument
+int text_length(std::string strText)
+{
+	return (int)strText.size();
+}
+
+#ifdef DT_PARSE_ARENA
+// the argument is allocated in the parse arena
+int arena_text_length(std::pmr::string strText)
+{
+	return (int)strText.size();
+}
+#endif
+
+template<typename String>
+String make_script(size_t nBytes)
+{
+	String strScript;
+	size_t i = 0;
+
+	while(strScript.size() < nBytes)
+	{
+		std::string strLine = "add " + std::to_string(i * 7919 % 100000) + " " + std::to_string(i % 1000) + "\n";
+		strScript.append(strLine.begin(), strLine.end());
+		i++;
+	}
+
+	return strScript;
+}
+
+template<typename Parser, typename String>
+void bench_one_throughput(char const* szName, String const& strScript)
+{
+	DT::interpreter<Parser, int> interp;
+	interp.register_function("add", &add);
+	interp.freeze();
+
+	const size_t nRuns = iterations(5);
+	double dNs = ns_per_iteration(nRuns, [&](size_t) { g_sink = interp.parse_input(strScript); });
+	double dMB = (double)(strScript.size() * sizeof(typename String::value_type)) / (1024 * 1024);
+
+	std::printf("%-34s %12.1f\n", szName, dMB / (dNs / 1e9));
+}
+
+// the script is read from a stream by chunks, the stream is rewound for every run
+template<typename Parser, typename Char>
+void bench_one_stream_throughput(char const* szName, std::basic_string<Char> const& strScript)
+{
+	DT::interpreter<Parser, int> interp;
+	interp.register_function("add", &add);
+	interp.freeze();
+
+	std::basic_istringstream<Char> stream(strScript);
+	const size_t nRuns = iterations(5);
+	double dNs = ns_per_iteration(nRuns, [&](size_t) {
+		stream.clear();
+		stream.seekg(0);
+		g_sink = interp.parse_input(DT::make_token_stream(stream));
+	});
+	double dMB = (double)(strScript.size() * sizeof(Char)) / (1024 * 1024);
+
+	std::printf("%-34s %12.1f\n", szName, dMB / (dNs / 1e9));
+}
+
+void bench_throughput()
+{
+	typedef DT::interpreter<> default_interpreter;
+
+	const size_t nBytes = 8 * 1024 * 1024;
+	std::string strScript = make_script<std::string>(nBytes);
+	std::wstring strWScript = make_script<std::wstring>(nBytes);
+
+	std::printf("\n3. tokenize and convert throughput (8M chars of \"add a b\")\n");
+	std::printf("%-34s %12s\n", "parser", "MB/s");
+
+	bench_one_throughput<default_interpreter::_string_param_parser>("char_separator<char>", strScript);
+	bench_one_throughput<default_interpreter::_wstring_param_parser>("char_separator<wchar_t>", strWScript);
+	bench_one_throughput<default_interpreter::_string_view_param_parser>("token_view_iterator<char>", strScript);
+	bench_one_throughput<default_interpreter::_wstring_view_param_parser>("token_view_iterator<wchar_t>", strWScript);
+	bench_one_stream_throughput<default_interpreter::_stream_param_parser>("token_stream_iterator<char>", strScript);
+	bench_one_stream_throughput<default_interpreter::_wstream_param_parser>("token_stream_iterator<wchar_t>", strWScript);
+}
+
+void bench_allocations()
+{
+	typedef DT::interpreter<> default_interpreter;
+
+	DT::interpreter<constant_parser, int> constant_interp;
+	size_t fnID = constant_interp.register_function("add", &add);
+	constant_interp.freeze();
+
+	DT::interpreter<default_interpreter::_string_param_parser, int> string_interp;
+	string_interp.register_function("add", &add);
+	string_interp.register_function("length", &text_length);
+	string_interp.freeze();
+
+	DT::interpreter<default_interpreter::_string_view_param_parser, int> view_interp;
+	view_interp.register_function("add", &add);
+	view_interp.freeze();
+
+	default_interpreter small_any_interp;
+	small_any_interp.register_function("add", &add);
+	small_any_interp.freeze();
+
+	default_interpreter pure_interp;
+	pure_interp.register_function("add", &add, DT::pure_function());
+	pure_interp.freeze();
+
+	DT::interpreter<default_interpreter::_string_param_parser, boost::any> any_interp;
+	any_interp.register_function("add", &add);
+	any_interp.freeze();
+
+#ifdef DT_PARSE_ARENA
+	DT::interpreter<default_interpreter::_string_view_param_parser, int> arena_interp;
+	arena_interp.register_function("length", &arena_text_length);
+	arena_interp.EnableParseArena();
+	arena_interp.freeze();
+#endif
+
+	std::string strCommand = "add 12345 678";
+	std::string strLengthCommand = "length " + std::string(100, 'x');
+	DT::interpreter<default_interpreter::_string_param_parser, int>::program prog = string_interp.compile(strCommand);
+	constant_parser parser = {1};
+	const size_t nCalls = 1000;
+
+	std::printf("\n4. heap allocations per call\n");
+	std::printf("%-34s %12s\n", "path", "allocs/call");
+	std::printf("%-34s %12.2f\n", "ExecInvoker", allocs_per_iteration(nCalls, [&](size_t) { g_sink = constant_interp.ExecInvoker(fnID, parser); }));
+	std::printf("%-34s %12.2f\n", "typed ExecInvoker<int>", allocs_per_iteration(nCalls, [&](size_t) { g_sink = constant_interp.ExecInvoker<int>(fnID, parser); }));
+	std::printf("%-34s %12.2f\n", "parse_input char_separator", allocs_per_iteration(nCalls, [&](size_t) { g_sink = string_interp.parse_input(strCommand); }));
+	std::printf("%-34s %12.2f\n", "parse_input by-value string", allocs_per_iteration(nCalls, [&](size_t) { g_sink = string_interp.parse_input(strLengthCommand); }));
+#ifdef DT_PARSE_ARENA
+	std::printf("%-34s %12.2f\n", "parse_input pmr string in arena", allocs_per_iteration(nCalls, [&](size_t) { g_sink = arena_interp.parse_input(strLengthCommand); }));
+#endif
+	std::printf("%-34s %12.2f\n", "parse_input token_view", allocs_per_iteration(nCalls, [&](size_t) { g_sink = view_interp.parse_input(strCommand); }));
+	std::printf("%-34s %12.2f\n", "parse_input small_any result", allocs_per_iteration(nCalls, [&](size_t) { small_any_interp.parse_input(strCommand); }));
+	std::printf("%-34s %12.2f\n", "parse_input pure function hit", allocs_per_iteration(nCalls, [&](size_t) { pure_interp.parse_input(strCommand); }));
+	std::printf("%-34s %12.2f\n", "parse_input boost::any result", allocs_per_iteration(nCalls, [&](size_t) { any_interp.parse_input(strCommand); }));
+	std::printf("%-34s %12.2f\n", "execute compiled program", allocs_per_iteration(nCalls, [&](size_t) { g_sink = string_interp.execute(prog); }));
+}
+
+void bench_batch()
+{
+	DT::interpreter<constant_parser, int> interp;
+	size_t fnID = interp.register_function("add", &add);
+	interp.freeze();
+
+	const size_t nRows = 1024 * 1024;
+	std::vector<int> a(nRows), b(nRows), out(nRows);
+
+	for(size_t i = 0; i < nRows; i++)
+	{
+		a[i] = (int)(i * 7919 % 100000);
+		b[i] = (int)(i % 1000);
+	}
+
+	constant_parser parser = {1};
+	const size_t nRuns = iterations(20);
+
+	double dRowNs = ns_per_iteration(nRuns * nRows, [&](size_t i) { out[i % nRows] = interp.ExecInvoker<int>(fnID, parser); });
+	double dBatchNs = ns_per_iteration(nRuns, [&](size_t) { interp.ApplyBatch(fnID, nRows, out.data(), a.data(), b.data()); }) / nRows;
+
+	std::printf("\n5. batch apply over %u rows\n", (unsigned)nRows);
+	std::printf("%-34s %12s\n", "path", "ns/row");
+	std::printf("%-34s %12.2f\n", "typed ExecInvoker<int> per row", dRowNs);
+	std::printf("%-34s %12.2f\n", "ApplyBatch", dBatchNs);
+}
+
+void bench_parse_cache()
+{
+	typedef DT::interpreter<> default_interpreter;
+	DT::interpreter<default_interpreter::_string_param_parser, int> interp;
+	interp.register_function("add", &add);
+	interp.freeze();
+
+	// a working set of distinct command lines, each one repeated many times
+	std::vector<std::string> commands;
+	for(size_t i = 0; i < 64; i++)
+		commands.push_back("add " + std::to_string(i * 7919) + " " + std::to_string(i));
+
+	const size_t nCalls = iterations(2000000);
+	int nTotal = 0;
+
+	double dParsed = ns_per_iteration(nCalls, [&](size_t i) { nTotal += interp.parse_input(commands[i % commands.size()]); });
+	interp.EnableParseCache();
+	double dCached = ns_per_iteration(nCalls, [&](size_t i) { nTotal += interp.parse_input(commands[i % commands.size()]); });
+
+	DT::memo_stats stats = interp.GetParseCacheStats();
+	g_sink = nTotal;
+
+	std::printf("\n6. parse_input of %u repeated command lines\n", (unsigned)commands.size());
+	std::printf("%-34s %12s\n", "path", "ns/call");
+	std::printf("%-34s %12.2f\n", "parse_input", dParsed);
+	std::printf("%-34s %12.2f\n", "parse_input with parse cache", dCached);
+	std::printf("%-34s %11.2f%%\n", "parse cache hit rate", 100.0 * stats.hits / (stats.hits + stats.misses));
+}
+
+void bench_pipeline()
+{
+	typedef DT::interpreter<> default_interpreter;
+	DT::interpreter<default_interpreter::_string_param_parser, int> interp;
+	interp.register_function("add", &add);
+	interp.register_function("square", &square);
+	interp.register_pipeline("add_square", &add, &square);
+	interp.freeze();
+
+	const size_t nCalls = iterations(1000000);
+	std::string strAdd = "add 1234 5678";
+	std::string strPipeline = "add_square 1234 5678";
+	int nTotal = 0;
+
+	// the caller formats the first result into the next command, it is parsed again
+	double dText = ns_per_iteration(nCalls, [&](size_t) { nTotal += interp.parse_input("square " + std::to_string(interp.parse_input(strAdd))); });
+	double dPipeline = ns_per_iteration(nCalls, [&](size_t) { nTotal += interp.parse_input(strPipeline); });
+
+	g_sink = nTotal;
+
+	std::printf("\n7. two chained commands\n");
+	std::printf("%-34s %12s\n", "path", "ns/call");
+	std::printf("%-34s %12.2f\n", "format and parse_input again", dText);
+	std::printf("%-34s %12.2f\n", "register_pipeline", dPipeline);
+}
+
+void bench_binary()
+{
+	typedef DT::interpreter<> default_interpreter;
+	DT::interpreter<default_interpreter::_string_view_param_parser, int> text_interp;
+	text_interp.register_function("add", &add);
+	text_interp.freeze();
+
+	DT::interpreter<DT::binary_param_parser, int> binary_interp;
+	size_t fnID = binary_interp.register_function("add", &add);
+	binary_interp.freeze();
+
+	const size_t nCalls = iterations(2000000);
+	const std::string strCommand = "add 1234567 7654321";
+	DT::binary_args command, args;
+	command.command("add", 1234567, 7654321);
+	args.append(1234567, 7654321);
+	int nTotal = 0;
+
+	double dText = ns_per_iteration(nCalls, [&](size_t) { nTotal += text_interp.parse_input(strCommand); });
+	double dCommand = ns_per_iteration(nCalls, [&](size_t) { nTotal += binary_interp.parse_input(command); });
+	double dArgs = ns_per_iteration(nCalls, [&](size_t)
+	{
+		DT::binary_param_parser parser(args.data(), args.data() + args.size());
+		nTotal += binary_interp.ExecInvoker(fnID, parser);
+	});
+
+	// the producer encodes the typed values for every call
+	double dEncode = ns_per_iteration(nCalls, [&](size_t i)
+	{
+		args.clear();
+		args.append((int)i, 7654321);
+
+		DT::binary_param_parser parser(args.data(), args.data() + args.size());
+		nTotal += binary_interp.ExecInvoker(fnID, parser);
+	});
+
+	g_sink = nTotal;
+
+	std::printf("\n8. add(int, int) by the text and the binary arguments\n");
+	std::printf("%-34s %12s\n", "input", "ns/call");
+	std::printf("%-34s %12.2f\n", "text parse_input", dText);
+	std::printf("%-34s %12.2f\n", "binary parse_input", dCommand);
+	std::printf("%-34s %12.2f\n", "binary ExecInvoker", dArgs);
+	std::printf("%-34s %12.2f\n", "encode and binary ExecInvoker", dEncode);
+}
+
+void bench_json_rpc()
+{
+	typedef DT::interpreter<> default_interpreter;
+	typedef DT::interpreter<DT::json_param_parser, int> json_interpreter;
+
+	DT::interpreter<default_interpreter::_string_view_param_parser, int> text_interp;
+	text_interp.register_function("add", &add);
+	text_interp.freeze();
+
+	json_interpreter json_interp;
+	DT::json_rpc_server<json_interpreter> server(json_interp);
+	server.register_function("add", &add);
+	json_interp.freeze();
+
+	const size_t nBatch = 100;
+	const size_t nCalls = iterations(1000000);
+	const std::string strCommand = "add 1234567 7654321";
+	const std::string strRequest = "{\"jsonrpc\":\"2.0\",\"method\":\"add\",\"params\":[1234567,7654321],\"id\":1}";
+	std::string strBatch = "[";
+	std::string strResponse;
+	int nTotal = 0;
+
+	for(size_t i = 0; i < nBatch; i++)
+		strBatch += (i > 0 ? "," : "") + strRequest;
+
+	strBatch += "]";
+
+	double dText = ns_per_iteration(nCalls, [&](size_t) { nTotal += text_interp.parse_input(strCommand); });
+	double dRequest = ns_per_iteration(nCalls, [&](size_t)
+	{
+		strResponse.clear();
+		server.handle(strRequest.data(), strRequest.size(), strResponse);
+	});
+	double dBatch = ns_per_iteration(nCalls / nBatch, [&](size_t)
+	{
+		strResponse.clear();
+		server.handle(strBatch.data(), strBatch.size(), strResponse);
+	}) / nBatch;
+
+	g_sink = nTotal + (int)strResponse.size();
+
+	std::printf("\n9. add(int, int) by JSON-RPC\n");
+	std::printf("%-34s %12s\n", "input", "ns/call");
+	std::printf("%-34s %12.2f\n", "text parse_input", dText);
+	std::printf("%-34s %12.2f\n", "JSON-RPC request", dRequest);
+	std::printf("%-34s %12.2f\n", "JSON-RPC batch of 100", dBatch);
+}
+
+int main(int argc, char* argv[])
+{
+	if(argc > 1)
+		g_dScale = std::atof(argv[1]);
+
+	bench_dispatch();
+	bench_arity(std::make_index_sequence<DT_BENCH_MAX_ARITY + 1>());
+	bench_throughput();
+	bench_allocations();
+	bench_batch();
+	bench_parse_cache();
+	bench_pipeline();
+	bench_binary();
+	bench_json_rpc();
+
+	return 0;
+}
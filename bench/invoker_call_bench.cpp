@@ -0,0 +1,151 @@
+/**
+ * (C) Copyright 2013 Dreamer
+ *
+ * this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+* Call overhead of the invoker storage. The "boost::function + bind" case is the storage the 
+* interpreter used before inline_function, it binds the same target so only the wrapper differs.
+*
+*	g++ -O2 -std=c++11 -I.. invoker_call_bench.cpp -o invoker_call_bench -lpthread
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <new>
+
+#include <boost/function.hpp>
+#include <boost/bind/bind.hpp>
+
+#include "Interpreter.hpp"
+
+static size_t g_nAllocs = 0;
+volatile int g_sink = 0;
+
+void* operator new(size_t size)
+{
+	g_nAllocs++;
+
+	if(void* p = std::malloc(size ? size : 1))
+		return p;
+
+	throw std::bad_alloc();
+}
+
+void operator delete(void* p) throw()
+{
+	std::free(p);
+}
+
+void operator delete(void* p, size_t) throw()
+{
+	std::free(p);
+}
+
+// hands out the same value for every parameter, so the benchmark measures the dispatch only
+struct constant_parser
+{
+	int value;
+
+	template<typename T> T get() { return T(value); }
+	bool has_more_tokens() const { return false; }
+};
+
+struct accumulator
+{
+	int base;
+
+	int add(int a, int b) { return base + a + b; }
+};
+
+template<typename Function, typename TheClass>
+int legacy_apply(Function func, TheClass* theclass, constant_parser& parser)
+{
+	int a = parser.get<int>();
+	int b = parser.get<int>();
+
+	return (theclass->*func)(a, b);
+}
+
+template<typename Function, typename TheClass>
+struct legacy_binder
+{
+	Function func;
+	TheClass* theclass;
+
+	int operator()(constant_parser& parser) const
+	{
+		return legacy_apply(func, theclass, parser);
+	}
+};
+
+template<typename Callable>
+double ns_per_call(Callable& target, size_t nCalls)
+{
+	// read the target through a volatile pointer, the compiler can't inline the stored callable
+	Callable* volatile pTarget = &target;
+	constant_parser parser = {1};
+	int total = 0;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	for(size_t i = 0; i < nCalls; i++)
+		total += (*pTarget)(parser);
+
+	std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+	g_sink = total;
+
+	return elapsed.count() / nCalls;
+}
+
+int main(int argc, char* argv[])
+{
+	using namespace boost::placeholders;
+
+	typedef int (accumulator::*add_type)(int, int);
+	const size_t nCalls = argc > 1 ? (size_t)std::atoll(argv[1]) : 50000000;
+
+	accumulator acc = {10};
+
+	size_t nAllocs = g_nAllocs;
+	boost::function<int (constant_parser&)> legacy = boost::bind(&legacy_apply<add_type, accumulator>, &accumulator::add, &acc, _1);
+	size_t nLegacyAllocs = g_nAllocs - nAllocs;
+
+	legacy_binder<add_type, accumulator> binder = {&accumulator::add, &acc};
+
+	nAllocs = g_nAllocs;
+	DT::inline_function<int (constant_parser&)> inlined(binder);
+	size_t nInlineAllocs = g_nAllocs - nAllocs;
+
+	DT::interpreter<constant_parser, int> interp;
+	size_t fnID = interp.register_function("add", &accumulator::add, &acc);
+	interp.freeze();
+
+	struct exec_invoker
+	{
+		DT::interpreter<constant_parser, int>* pInterp;
+		size_t fnID;
+
+		int operator()(constant_parser& parser) const { return pInterp->ExecInvoker(fnID, parser); }
+	} exec = {&interp, fnID};
+
+	std::printf("%-32s %12s %14s\n", "invoker storage", "ns/call", "allocs/bind");
+	std::printf("%-32s %12.2f %14u\n", "boost::function + boost::bind", ns_per_call(legacy, nCalls), (unsigned)nLegacyAllocs);
+	std::printf("%-32s %12.2f %14u\n", "DT::inline_function", ns_per_call(inlined, nCalls), (unsigned)nInlineAllocs);
+	std::printf("%-32s %12.2f %14s\n", "frozen interpreter::ExecInvoker", ns_per_call(exec, nCalls), "-");
+
+	return 0;
+}
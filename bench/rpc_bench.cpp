@@ -0,0 +1,161 @@
+/**
+ * (C) Copyright 2013 Dreamer
+ *
+ * this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+* The shared memory RPC benchmark. The host serves an interpreter on a shm_channel, a forked
+* client process reports
+*	1. the round trip latency of a synchronous call, against parse_input() in the host
+*	2. the throughput of the batched calls by the batch size
+*
+* The optional argument scales the iteration counts, e.g. "rpc_bench 0.1" for a quick run.
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "shm_rpc.hpp"
+
+static double g_dScale = 1.0;
+volatile int g_sink = 0;
+
+int add(int a, int b)
+{
+	return a + b;
+}
+
+size_t text_length(std::string const& str)
+{
+	return str.size();
+}
+
+inline size_t iterations(size_t nBase)
+{
+	size_t nCount = (size_t)(nBase * g_dScale);
+	return nCount > 0 ? nCount : 1;
+}
+
+template<typename Body>
+double ns_per_iteration(size_t nCount, Body const& body)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	for(size_t i = 0; i < nCount; i++)
+		body(i);
+
+	std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+	return elapsed.count() / nCount;
+}
+
+void bench_latency(DT::rpc_client& client, size_t nAdd, size_t nLength)
+{
+	DT::interpreter<DT::interpreter<>::_string_view_param_parser, int> interp;
+	interp.register_function("add", &add);
+	interp.freeze();
+
+	const size_t nCalls = iterations(200000);
+	const std::string strText(64, 'x');
+	int nTotal = 0;
+
+	double dText = ns_per_iteration(nCalls, [&](size_t i) { nTotal += interp.parse_input("add 1 " + std::to_string(i & 1023)); });
+	double dAdd = ns_per_iteration(nCalls, [&](size_t i) { nTotal += client.call<int>(nAdd, 1, (int)(i & 1023)).value(); });
+	double dString = ns_per_iteration(nCalls, [&](size_t) { nTotal += (int)client.call<size_t>(nLength, strText).value(); });
+
+	g_sink = nTotal;
+	std::printf("\n1. synchronous call latency\n");
+	std::printf("%-32s %12s\n", "call", "ns/call");
+	std::printf("%-32s %12.2f\n", "parse_input in the host", dText);
+	std::printf("%-32s %12.2f\n", "rpc add(int, int)", dAdd);
+	std::printf("%-32s %12.2f\n", "rpc length(64 byte string)", dString);
+}
+
+void bench_batch(DT::rpc_client& client, size_t nAdd)
+{
+	const size_t sizes[] = {1, 16, 256, 4096};
+
+	std::printf("\n2. batched call throughput\n");
+	std::printf("%10s %14s %14s\n", "batch", "ns/call", "Mcalls/s");
+
+	for(size_t n = 0; n < sizeof(sizes) / sizeof(sizes[0]); n++)
+	{
+		const size_t nBatches = iterations(1000000) / sizes[n] + 1;
+		int nTotal = 0;
+
+		double dBatch = ns_per_iteration(nBatches, [&](size_t)
+		{
+			for(size_t i = 0; i < sizes[n]; i++)
+				client.post(nAdd, 1, (int)i);
+
+			client.flush();
+
+			for(size_t i = 0; i < sizes[n]; i++)
+				nTotal += client.receive<int>().value();
+		});
+
+		g_sink = nTotal;
+		std::printf("%10u %14.2f %14.2f\n", (unsigned)sizes[n], dBatch / sizes[n], 1000.0 * sizes[n] / dBatch);
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	typedef DT::interpreter<DT::rpc_param_parser, int> host_interpreter;
+
+	if(argc > 1)
+		g_dScale = std::atof(argv[1]);
+
+	const std::string strName = "/dt_rpc_bench_" + std::to_string(::getpid());
+	std::unique_ptr<DT::shm_channel> pChannel(DT::shm_channel::create(strName));
+
+	host_interpreter interp;
+	DT::rpc_server<host_interpreter> server(interp, *pChannel);
+	size_t nAdd = server.register_function("add", &add);
+	size_t nLength = server.register_function("length", &text_length);
+
+	// fork before the host thread starts, the client process has a single thread
+	std::fflush(stdout);
+	pid_t pid = ::fork();
+
+	if(pid == 0)
+	{
+		std::unique_ptr<DT::shm_channel> pClientChannel(DT::shm_channel::open(strName));
+		DT::rpc_client client(*pClientChannel);
+
+		bench_latency(client, nAdd, nLength);
+		bench_batch(client, nAdd);
+
+		std::fflush(stdout);
+		::_exit(0);
+	}
+
+	std::thread host([&server]() { server.run(); });
+	int nStatus = 0;
+
+	if(pid > 0)
+		::waitpid(pid, &nStatus, 0);
+
+	server.stop();
+	host.join();
+
+	return pid > 0 && WIFEXITED(nStatus) ? WEXITSTATUS(nStatus) : 1;
+}
@@ -0,0 +1,590 @@
+/**
+ * (C) Copyright 2013 Dreamer
+ *
+ * this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+* The binary arguments of the interpreter. A value is a type tag and the big endian bytes of the
+* value, the strings are length prefixed. The tags are the MessagePack ones for nil, bool, the
+* integers, the floats, str and bin, so a MessagePack encoder writes the arguments as well.
+*
+* binary_param_parser reads the values straight into the parameter types, a number is never
+* formatted as text. An integer is range checked into any integer parameter, a float parameter
+* takes the integers too, and nil is the default value of any parameter. binary_args writes the
+* arguments of ExecInvoker(), or the commands of parse_input() with the function names as strings:
+*
+*	interpreter<binary_param_parser> interp;
+*	interp.parse_input(binary_args().command("add", 1, 2).command("concat", "a", "b"));
+*/
+
+#ifndef _DT_BINARY_PARAMS_
+#define _DT_BINARY_PARAMS_
+
+#include <cstddef>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <typeinfo>
+
+#include <boost/cstdint.hpp>
+
+#include "token_cast.hpp"
+
+#ifdef __cpp_lib_string_view
+#include <string_view>
+#endif
+
+namespace DT
+{
+	/** the type tags of the values, the fix tags keep a small value or length in the low bits */
+	enum binary_tag
+	{
+		binary_fixint = 0x00,
+		binary_fixstr = 0xa0,
+		binary_nil = 0xc0,
+		binary_false = 0xc2,
+		binary_true = 0xc3,
+		binary_bin8 = 0xc4,
+		binary_bin16 = 0xc5,
+		binary_bin32 = 0xc6,
+		binary_float32 = 0xca,
+		binary_float64 = 0xcb,
+		binary_uint8 = 0xcc,
+		binary_uint16 = 0xcd,
+		binary_uint32 = 0xce,
+		binary_uint64 = 0xcf,
+		binary_int8 = 0xd0,
+		binary_int16 = 0xd1,
+		binary_int32 = 0xd2,
+		binary_int64 = 0xd3,
+		binary_str8 = 0xd9,
+		binary_str16 = 0xda,
+		binary_str32 = 0xdb,
+		binary_negative_fixint = 0xe0
+	};
+
+	namespace detail
+	{
+		template<typename Int>
+		inline void binary_put(std::string& buffer, Int nValue)
+		{
+			char bytes[sizeof(Int)];
+
+			for(size_t i = 0; i < sizeof(Int); i++)
+				bytes[i] = (char)(nValue >> (8 * (sizeof(Int) - 1 - i)));
+
+			buffer.append(bytes, sizeof(Int));
+		}
+
+		template<typename Int>
+		inline bool binary_take(char const*& p, char const* pEnd, Int& nValue)
+		{
+			if((size_t)(pEnd - p) < sizeof(Int))
+				return false;
+
+			nValue = 0;
+			for(size_t i = 0; i < sizeof(Int); i++)
+				nValue = (Int)((nValue << 8) | (unsigned char)p[i]);
+
+			p += sizeof(Int);
+			return true;
+		}
+
+		// an integer of any tag, bNegative tells how to read nValue
+		inline bool binary_read_integer(char const*& p, char const* pEnd, boost::uint64_t& nValue, bool& bNegative)
+		{
+			unsigned char tag = (unsigned char)*p++;
+			bNegative = false;
+
+			if(tag < 0x80)
+			{
+				nValue = tag;
+				return true;
+			}
+
+			if(tag >= binary_negative_fixint)
+			{
+				nValue = (boost::uint64_t)(boost::int64_t)(signed char)tag;
+				bNegative = true;
+				return true;
+			}
+
+			switch(tag)
+			{
+			case binary_uint8: { boost::uint8_t n; if(!binary_take(p, pEnd, n)) return false; nValue = n; return true; }
+			case binary_uint16: { boost::uint16_t n; if(!binary_take(p, pEnd, n)) return false; nValue = n; return true; }
+			case binary_uint32: { boost::uint32_t n; if(!binary_take(p, pEnd, n)) return false; nValue = n; return true; }
+			case binary_uint64: return binary_take(p, pEnd, nValue);
+			case binary_int8: { boost::uint8_t n; if(!binary_take(p, pEnd, n)) return false; nValue = (boost::uint64_t)(boost::int64_t)(boost::int8_t)n; break; }
+			case binary_int16: { boost::uint16_t n; if(!binary_take(p, pEnd, n)) return false; nValue = (boost::uint64_t)(boost::int64_t)(boost::int16_t)n; break; }
+			case binary_int32: { boost::uint32_t n; if(!binary_take(p, pEnd, n)) return false; nValue = (boost::uint64_t)(boost::int64_t)(boost::int32_t)n; break; }
+			case binary_int64: if(!binary_take(p, pEnd, nValue)) return false; break;
+			default: return false;
+			}
+
+			bNegative = (boost::int64_t)nValue < 0;
+			return true;
+		}
+
+		// the bytes of a str or a bin value
+		inline bool binary_read_bytes(char const*& p, char const* pEnd, char const*& pBytes, size_t& nLength)
+		{
+			unsigned char tag = (unsigned char)*p++;
+
+			if((tag & 0xe0) == binary_fixstr)
+				nLength = tag & 0x1f;
+			else if(tag == binary_str8 || tag == binary_bin8)
+			{
+				boost::uint8_t n;
+				if(!binary_take(p, pEnd, n)) return false;
+				nLength = n;
+			}
+			else if(tag == binary_str16 || tag == binary_bin16)
+			{
+				boost::uint16_t n;
+				if(!binary_take(p, pEnd, n)) return false;
+				nLength = n;
+			}
+			else if(tag == binary_str32 || tag == binary_bin32)
+			{
+				boost::uint32_t n;
+				if(!binary_take(p, pEnd, n)) return false;
+				nLength = n;
+			}
+			else
+				return false;
+
+			if((size_t)(pEnd - p) < nLength)
+				return false;
+
+			pBytes = p;
+			p += nLength;
+			return true;
+		}
+
+		inline void binary_write_bytes(std::string& buffer, char const* pBytes, size_t nLength)
+		{
+			if(nLength < 32)
+				buffer += (char)(binary_fixstr | nLength);
+			else if(nLength <= 0xff)
+			{
+				buffer += (char)binary_str8;
+				binary_put(buffer, (boost::uint8_t)nLength);
+			}
+			else if(nLength <= 0xffff)
+			{
+				buffer += (char)binary_str16;
+				binary_put(buffer, (boost::uint16_t)nLength);
+			}
+			else
+			{
+				buffer += (char)binary_str32;
+				binary_put(buffer, (boost::uint32_t)nLength);
+			}
+
+			buffer.append(pBytes, nLength);
+		}
+	}
+
+	/**
+	* Write and read the values of the type T. read() is called at a value which isn't nil and
+	* returns false for a wrong tag, a truncated value or a value out of the range of T. Specialize
+	* it for the own parameter types.
+	*/
+	template<typename T, typename Enable = void>
+	struct binary_codec
+	{
+		static_assert(sizeof(T) == 0, "specialize DT::binary_codec for the parameter type");
+	};
+
+	template<>
+	struct binary_codec<bool>
+	{
+		static inline void write(std::string& buffer, bool bValue)
+		{
+			buffer += (char)(bValue ? binary_true : binary_false);
+		}
+
+		static inline bool read(char const*& p, char const*, bool& bValue)
+		{
+			unsigned char tag = (unsigned char)*p;
+
+			if(tag != binary_true && tag != binary_false)
+				return false;
+
+			bValue = tag == binary_true;
+			p++;
+			return true;
+		}
+	};
+
+	/** the integers are written in the smallest form */
+	template<typename T>
+	struct binary_codec<T, typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value>::type>
+	{
+		static inline void write(std::string& buffer, T value)
+		{
+			if(value >= 0)
+				write_unsigned(buffer, (boost::uint64_t)value);
+			else
+				write_negative(buffer, (boost::int64_t)value);
+		}
+
+		static inline bool read(char const*& p, char const* pEnd, T& value)
+		{
+			char const* pAt = p;
+			boost::uint64_t nValue = 0;
+			bool bNegative = false;
+
+			if(!detail::binary_read_integer(pAt, pEnd, nValue, bNegative))
+				return false;
+
+			if(bNegative ? !std::is_signed<T>::value || (boost::int64_t)nValue < (boost::int64_t)(std::numeric_limits<T>::min)()
+				: nValue > (boost::uint64_t)(std::numeric_limits<T>::max)())
+				return false;
+
+			value = (T)nValue;
+			p = pAt;
+			return true;
+		}
+
+	private:
+		static inline void write_unsigned(std::string& buffer, boost::uint64_t nValue)
+		{
+			if(nValue < 0x80)
+				buffer += (char)nValue;
+			else if(nValue <= 0xff)
+			{
+				buffer += (char)binary_uint8;
+				detail::binary_put(buffer, (boost::uint8_t)nValue);
+			}
+			else if(nValue <= 0xffff)
+			{
+				buffer += (char)binary_uint16;
+				detail::binary_put(buffer, (boost::uint16_t)nValue);
+			}
+			else if(nValue <= 0xffffffff)
+			{
+				buffer += (char)binary_uint32;
+				detail::binary_put(buffer, (boost::uint32_t)nValue);
+			}
+			else
+			{
+				buffer += (char)binary_uint64;
+				detail::binary_put(buffer, nValue);
+			}
+		}
+
+		static inline void write_negative(std::string& buffer, boost::int64_t nValue)
+		{
+			if(nValue >= -32)
+				buffer += (char)nValue;
+			else if(nValue >= -0x80)
+			{
+				buffer += (char)binary_int8;
+				detail::binary_put(buffer, (boost::uint8_t)nValue);
+			}
+			else if(nValue >= -0x8000)
+			{
+				buffer += (char)binary_int16;
+				detail::binary_put(buffer, (boost::uint16_t)nValue);
+			}
+			else if(nValue >= -0x7fffffffLL - 1)
+			{
+				buffer += (char)binary_int32;
+				detail::binary_put(buffer, (boost::uint32_t)nValue);
+			}
+			else
+			{
+				buffer += (char)binary_int64;
+				detail::binary_put(buffer, (boost::uint64_t)nValue);
+			}
+		}
+	};
+
+	/** a float is float32 and the other floating types float64, they read the integers too */
+	template<typename T>
+	struct binary_codec<T, typename std::enable_if<std::is_floating_point<T>::value>::type>
+	{
+		static inline void write(std::string& buffer, T value)
+		{
+			if(sizeof(T) == sizeof(float))
+			{
+				float fValue = (float)value;
+				boost::uint32_t nBits;
+
+				std::memcpy(&nBits, &fValue, sizeof(nBits));
+				buffer += (char)binary_float32;
+				detail::binary_put(buffer, nBits);
+			}
+			else
+			{
+				double dValue = (double)value;
+				boost::uint64_t nBits;
+
+				std::memcpy(&nBits, &dValue, sizeof(nBits));
+				buffer += (char)binary_float64;
+				detail::binary_put(buffer, nBits);
+			}
+		}
+
+		static inline bool read(char const*& p, char const* pEnd, T& value)
+		{
+			unsigned char tag = (unsigned char)*p;
+
+			if(tag == binary_float32)
+			{
+				char const* pAt = p + 1;
+				boost::uint32_t nBits;
+				float fValue;
+
+				if(!detail::binary_take(pAt, pEnd, nBits))
+					return false;
+
+				std::memcpy(&fValue, &nBits, sizeof(fValue));
+				value = (T)fValue;
+				p = pAt;
+				return true;
+			}
+
+			if(tag == binary_float64)
+			{
+				char const* pAt = p + 1;
+				boost::uint64_t nBits;
+				double dValue;
+
+				if(!detail::binary_take(pAt, pEnd, nBits))
+					return false;
+
+				std::memcpy(&dValue, &nBits, sizeof(dValue));
+				value = (T)dValue;
+				p = pAt;
+				return true;
+			}
+
+			char const* pAt = p;
+			boost::uint64_t nValue = 0;
+			bool bNegative = false;
+
+			if(!detail::binary_read_integer(pAt, pEnd, nValue, bNegative))
+				return false;
+
+			value = bNegative ? (T)(boost::int64_t)nValue : (T)nValue;
+			p = pAt;
+			return true;
+		}
+	};
+
+	/** a string reads a str or a bin value */
+	template<typename Traits, typename Alloc>
+	struct binary_codec< std::basic_string<char,Traits,Alloc> >
+	{
+		static inline void write(std::string& buffer, std::basic_string<char,Traits,Alloc> const& value)
+		{
+			detail::binary_write_bytes(buffer, value.data(), value.size());
+		}
+
+		static inline bool read(char const*& p, char const* pEnd, std::basic_string<char,Traits,Alloc>& value)
+		{
+			char const* pAt = p;
+			char const* pBytes = NULL;
+			size_t nLength = 0;
+
+			if(!detail::binary_read_bytes(pAt, pEnd, pBytes, nLength))
+				return false;
+
+			value.assign(pBytes, nLength);
+			p = pAt;
+			return true;
+		}
+	};
+
+	template<>
+	struct binary_codec<char const*>
+	{
+		static inline void write(std::string& buffer, char const* szValue)
+		{
+			detail::binary_write_bytes(buffer, szValue, std::strlen(szValue));
+		}
+	};
+
+	template<>
+	struct binary_codec<char*> : binary_codec<char const*>
+	{ };
+
+#ifdef __cpp_lib_string_view
+	/** the read view refers into the buffer of the arguments */
+	template<typename Traits>
+	struct binary_codec< std::basic_string_view<char,Traits> >
+	{
+		static inline void write(std::string& buffer, std::basic_string_view<char,Traits> const& value)
+		{
+			detail::binary_write_bytes(buffer, value.data(), value.size());
+		}
+
+		static inline bool read(char const*& p, char const* pEnd, std::basic_string_view<char,Traits>& value)
+		{
+			char const* pAt = p;
+			char const* pBytes = NULL;
+			size_t nLength = 0;
+
+			if(!detail::binary_read_bytes(pAt, pEnd, pBytes, nLength))
+				return false;
+
+			value = std::basic_string_view<char,Traits>(pBytes, nLength);
+			p = pAt;
+			return true;
+		}
+	};
+#endif
+
+	/** the buffer of the binary arguments or commands */
+	class binary_args
+	{
+	public:
+		/** append the values */
+		template<typename... Args>
+		binary_args& append(Args const&... args)
+		{
+			int dummy[] = {0, (write(args), 0)...};
+
+			(void)dummy;
+			return *this;
+		}
+
+		/** append the function name and the arguments of a command for parse_input() */
+		template<typename... Args>
+		inline binary_args& command(std::string const& name, Args const&... args)
+		{
+			return append(name, args...);
+		}
+
+		/** append nil, the parameter takes its default value */
+		inline binary_args& nil()
+		{
+			buffer += (char)binary_nil;
+			return *this;
+		}
+
+		inline void clear()
+		{
+			buffer.clear();
+		}
+
+		inline char const* data() const
+		{
+			return buffer.data();
+		}
+
+		inline size_t size() const
+		{
+			return buffer.size();
+		}
+
+		inline std::string const& str() const
+		{
+			return buffer;
+		}
+
+	private:
+		template<typename T>
+		inline void write(T const& value)
+		{
+			binary_codec<typename std::decay<T>::type>::write(buffer, value);
+		}
+
+		std::string buffer;
+	};
+
+	/** the parser of the binary arguments, see binary_codec */
+	class binary_param_parser
+	{
+	public:
+		binary_param_parser(char const* pBegin, char const* pEnd)
+			: pAt(pBegin), pEnd(pEnd)
+		{ }
+
+		/** \throw std::runtime_error if the argument isn't of the type */
+		template<typename RequestedType>
+		typename std::decay<RequestedType>::type get()
+		{
+			bool bOk = false;
+			typename std::decay<RequestedType>::type value = try_get<RequestedType>(bOk);
+
+			if(!bOk)
+				throw std::runtime_error("invalid argument: the binary value isn't " + std::string(typeid(value).name()));
+
+			return value;
+		}
+
+		/** the missing argument and nil are the default value, like interpreter_param_parser */
+		template<typename RequestedType>
+		typename std::decay<RequestedType>::type try_get(bool & bOk)
+		{
+			typedef typename std::decay<RequestedType>::type value_type;
+			value_type value = detail::token_value<value_type>::make();
+
+			bOk = true;
+
+			if(!has_more_tokens())
+				return value;
+
+			if((unsigned char)*pAt == binary_nil)
+				pAt++;
+			else
+				bOk = binary_codec<value_type>::read(pAt, pEnd, value);
+
+			return value;
+		}
+
+		inline bool has_more_tokens() const
+		{
+			return pAt != pEnd;
+		}
+
+	private:
+		char const* pAt;
+		char const* pEnd;
+	};
+
+	template<typename T, typename R>
+	struct param_parser_factory;
+
+	template<>
+	struct param_parser_factory<binary_args, binary_param_parser>
+	{
+		typedef binary_param_parser result_type;
+
+		static inline result_type make(binary_args const& args)
+		{
+			return result_type(args.data(), args.data() + args.size());
+		}
+	};
+
+	/** the bytes of the binary commands in a string */
+	template<>
+	struct param_parser_factory<std::string, binary_param_parser>
+	{
+		typedef binary_param_parser result_type;
+
+		static inline result_type make(std::string const& args)
+		{
+			return result_type(args.data(), args.data() + args.size());
+		}
+	};
+}
+
+#endif
@@ -0,0 +1,292 @@
+/**
+ * (C) Copyright 2013 Dreamer
+ *
+ * this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+* The call metrics of the interpreter functions. Every thread counts its own calls in its own
+* block, so the dispatch only writes the memory of the calling thread without a lock or an atomic
+* read-modify-write. The blocks are merged when the metrics are read.
+*
+* The interpreter records them only if DT_INTERPRETER_METRICS is defined, otherwise there is no
+* code or data for them in the dispatch. Reading the clock is the most of the cost, define
+* DT_INTERPRETER_METRICS_SAMPLE as a power of 2 N to time only every Nth call of a function.
+*/
+
+#ifndef _DT_CALL_METRICS_
+#define _DT_CALL_METRICS_
+
+#include <cstddef>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+
+#ifndef DT_INTERPRETER_METRICS_SAMPLE
+#define DT_INTERPRETER_METRICS_SAMPLE 1
+#endif
+
+#if (DT_INTERPRETER_METRICS_SAMPLE & (DT_INTERPRETER_METRICS_SAMPLE - 1)) != 0
+#error DT_INTERPRETER_METRICS_SAMPLE must be a power of 2
+#endif
+
+namespace DT
+{
+	/**
+	* The histogram buckets of the call latency. The bucket k counts the calls taking [2^k, 2^(k+1))
+	* nanoseconds, the bucket 0 also counts the shorter calls and the last one the longer calls.
+	*/
+	const size_t metrics_latency_buckets = 32;
+
+	/** the merged metrics of a function */
+	struct function_metrics
+	{
+		boost::uint64_t calls;
+
+		/** the calls failed by an invalid argument or by an exception of the function */
+		boost::uint64_t errors;
+
+		/** the calls in the latency histogram and total_ns, see DT_INTERPRETER_METRICS_SAMPLE */
+		boost::uint64_t timed_calls;
+
+		boost::uint64_t total_ns;
+		boost::uint64_t latency[metrics_latency_buckets];
+
+		function_metrics() : calls(0), errors(0), timed_calls(0), total_ns(0)
+		{
+			for(size_t i = 0; i < metrics_latency_buckets; i++)
+				latency[i] = 0;
+		}
+	};
+
+	namespace detail
+	{
+		// written by its thread only, the relaxed load and store keep the merge free of a data race
+		inline void metrics_add(std::atomic<boost::uint64_t>& counter, boost::uint64_t value)
+		{
+			counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+		}
+
+		struct metrics_cell
+		{
+			std::atomic<boost::uint64_t> calls;
+			std::atomic<boost::uint64_t> errors;
+			std::atomic<boost::uint64_t> timed_calls;
+			std::atomic<boost::uint64_t> total_ns;
+			std::atomic<boost::uint64_t> latency[metrics_latency_buckets];
+
+			metrics_cell() : calls(0), errors(0), timed_calls(0), total_ns(0)
+			{
+				for(size_t i = 0; i < metrics_latency_buckets; i++)
+					latency[i].store(0, std::memory_order_relaxed);
+			}
+
+			/** the next call is timed, it keeps every Nth call of DT_INTERPRETER_METRICS_SAMPLE */
+			inline bool time_next() const
+			{
+				return (calls.load(std::memory_order_relaxed) & (DT_INTERPRETER_METRICS_SAMPLE - 1)) == 0;
+			}
+
+			void record(bool bError)
+			{
+				metrics_add(calls, 1);
+
+				if(bError)
+					metrics_add(errors, 1);
+			}
+
+			void record_latency(boost::uint64_t nNs)
+			{
+				size_t nBucket = 0;
+				while(nBucket + 1 < metrics_latency_buckets && (nNs >> (nBucket + 1)) != 0)
+					nBucket++;
+
+				metrics_add(timed_calls, 1);
+				metrics_add(total_ns, nNs);
+				metrics_add(latency[nBucket], 1);
+			}
+
+			void merge_to(function_metrics& metrics) const
+			{
+				metrics.calls += calls.load(std::memory_order_relaxed);
+				metrics.errors += errors.load(std::memory_order_relaxed);
+				metrics.timed_calls += timed_calls.load(std::memory_order_relaxed);
+				metrics.total_ns += total_ns.load(std::memory_order_relaxed);
+
+				for(size_t i = 0; i < metrics_latency_buckets; i++)
+					metrics.latency[i] += latency[i].load(std::memory_order_relaxed);
+			}
+		};
+	}
+
+	/**
+	* The per-thread metrics of the functions indexed by a compact ID, the interpreter uses the
+	* symbol of the function name.
+	*/
+	class call_metrics
+	{
+		static const size_t cells_per_page = 64;
+		static const size_t page_count = 1024;
+
+		// the pages are allocated by the owner thread when it first calls a function of them
+		struct thread_block
+		{
+			std::atomic<detail::metrics_cell*> pages[page_count];
+
+			thread_block()
+			{
+				for(size_t i = 0; i < page_count; i++)
+					pages[i].store(NULL, std::memory_order_relaxed);
+			}
+
+			~thread_block()
+			{
+				for(size_t i = 0; i < page_count; i++)
+					delete [] pages[i].load(std::memory_order_relaxed);
+			}
+		};
+
+	public:
+		/** the IDs from max_id() up aren't counted */
+		static inline size_t max_id()
+		{
+			return cells_per_page * page_count;
+		}
+
+		call_metrics() : nInstance(next_instance())
+		{ }
+
+		/** the cell of the calling thread, NULL if the ID is too big */
+		detail::metrics_cell* local_cell(size_t ID)
+		{
+			if(ID >= max_id())
+				return NULL;
+
+			std::atomic<detail::metrics_cell*>& page = local_block()->pages[ID / cells_per_page];
+			detail::metrics_cell* pPage = page.load(std::memory_order_relaxed);
+
+			if(pPage == NULL)
+			{
+				pPage = new detail::metrics_cell[cells_per_page];
+				page.store(pPage, std::memory_order_release);
+			}
+
+			return pPage + ID % cells_per_page;
+		}
+
+		/** merge the blocks of all the threads, the result is indexed by the ID */
+		std::vector<function_metrics> merge(size_t nIDs) const
+		{
+			std::vector<function_metrics> result(nIDs < max_id() ? nIDs : max_id());
+			std::lock_guard<std::mutex> guard(blocks_lock);
+
+			for(size_t i = 0; i < blocks.size(); i++)
+			{
+				for(size_t nPage = 0; nPage * cells_per_page < result.size(); nPage++)
+				{
+					detail::metrics_cell const* pPage = blocks[i]->pages[nPage].load(std::memory_order_acquire);
+
+					for(size_t n = 0; pPage != NULL && n < cells_per_page && nPage * cells_per_page + n < result.size(); n++)
+						pPage[n].merge_to(result[nPage * cells_per_page + n]);
+				}
+			}
+
+			return result;
+		}
+
+	private:
+		// the block of this thread, the last one is cached. An instance number isn't reused, so
+		// the cache never finds the block of a destroyed instance
+		thread_block* local_block()
+		{
+			static thread_local boost::uint64_t nCachedInstance = 0;
+			static thread_local thread_block* pCachedBlock = NULL;
+
+			if(nCachedInstance == nInstance)
+				return pCachedBlock;
+
+			std::lock_guard<std::mutex> guard(blocks_lock);
+			thread_block*& pBlock = thread_blocks[std::this_thread::get_id()];
+
+			if(pBlock == NULL)
+			{
+				blocks.push_back(std::unique_ptr<thread_block>(new thread_block()));
+				pBlock = blocks.back().get();
+			}
+
+			nCachedInstance = nInstance;
+			pCachedBlock = pBlock;
+
+			return pBlock;
+		}
+
+		static boost::uint64_t next_instance()
+		{
+			static std::atomic<boost::uint64_t> nLast(0);
+
+			return nLast.fetch_add(1) + 1;
+		}
+
+		call_metrics(call_metrics const&);
+		call_metrics& operator=(call_metrics const&);
+
+		const boost::uint64_t nInstance;
+		mutable std::mutex blocks_lock;
+		std::vector< std::unique_ptr<thread_block> > blocks;
+		// a thread which reuses the ID of an exited one continues its block
+		std::unordered_map<std::thread::id, thread_block*> thread_blocks;
+	};
+
+	/** time a call and record it to the cell when it goes out of scope, an exception is an error */
+	class call_timer
+	{
+	public:
+		explicit call_timer(detail::metrics_cell* pCell)
+			: pCell(pCell), bTimed(pCell != NULL && pCell->time_next()), bError(true)
+		{
+			if(bTimed)
+				start = std::chrono::steady_clock::now();
+		}
+
+		~call_timer()
+		{
+			if(bTimed)
+				pCell->record_latency((boost::uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+
+			if(pCell != NULL)
+				pCell->record(bError);
+		}
+
+		inline void succeeded()
+		{
+			bError = false;
+		}
+
+	private:
+		call_timer(call_timer const&);
+		call_timer& operator=(call_timer const&);
+
+		detail::metrics_cell* pCell;
+		bool bTimed;
+		bool bError;
+		std::chrono::steady_clock::time_point start;
+	};
+}
+
+#endif
@@ -0,0 +1,152 @@
+/**
+ * (C) Copyright 2013 Dreamer
+ *
+ * this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+* The signature of a function pointer or a member function pointer as a parameter pack. It
+* replaces boost::function_types for the interpreter, so the arity isn't limited by
+* BOOST_FT_MAX_ARITY or FUSION_MAX_VECTOR_SIZE.
+*/
+
+#ifndef _DT_CALLABLE_TRAITS_
+#define _DT_CALLABLE_TRAITS_
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+namespace DT
+{
+	/** a list of types, it carries the parameter pack of a signature */
+	template<typename... Types>
+	struct type_list
+	{
+		static const size_t size = sizeof...(Types);
+	};
+
+	template<typename R, typename TheClass, typename... Args>
+	struct callable_signature
+	{
+		static const bool is_function = true;
+		static const bool is_member = true;
+
+		typedef R result_type;
+		typedef TheClass class_type;
+		typedef type_list<Args...> arg_types;
+	};
+
+	template<typename R, typename... Args>
+	struct callable_signature<R, void, Args...>
+	{
+		static const bool is_function = true;
+		static const bool is_member = false;
+
+		typedef R result_type;
+		typedef void class_type;
+		typedef type_list<Args...> arg_types;
+	};
+
+	template<typename Function>
+	struct callable_traits
+	{
+		static const bool is_function = false;
+		static const bool is_member = false;
+	};
+
+	template<typename R, typename... Args>
+	struct callable_traits<R (*)(Args...)> : callable_signature<R, void, Args...>
+	{ };
+
+	template<typename R, typename TheClass, typename... Args>
+	struct callable_traits<R (TheClass::*)(Args...)> : callable_signature<R, TheClass, Args...>
+	{ };
+
+	template<typename R, typename TheClass, typename... Args>
+	struct callable_traits<R (TheClass::*)(Args...) const> : callable_signature<R, TheClass, Args...>
+	{ };
+
+	template<typename R, typename TheClass, typename... Args>
+	struct callable_traits<R (TheClass::*)(Args...) volatile> : callable_signature<R, TheClass, Args...>
+	{ };
+
+	template<typename R, typename TheClass, typename... Args>
+	struct callable_traits<R (TheClass::*)(Args...) const volatile> : callable_signature<R, TheClass, Args...>
+	{ };
+
+#ifdef __cpp_noexcept_function_type
+	template<typename R, typename... Args>
+	struct callable_traits<R (*)(Args...) noexcept> : callable_signature<R, void, Args...>
+	{ };
+
+	template<typename R, typename TheClass, typename... Args>
+	struct callable_traits<R (TheClass::*)(Args...) noexcept> : callable_signature<R, TheClass, Args...>
+	{ };
+
+	template<typename R, typename TheClass, typename... Args>
+	struct callable_traits<R (TheClass::*)(Args...) const noexcept> : callable_signature<R, TheClass, Args...>
+	{ };
+#endif
+
+#if defined(_MSC_VER) && defined(_M_IX86)
+	//the COM methods are __stdcall, it is another function type on x86 only
+	template<typename R, typename... Args>
+	struct callable_traits<R (__stdcall *)(Args...)> : callable_signature<R, void, Args...>
+	{ };
+
+	template<typename R, typename TheClass, typename... Args>
+	struct callable_traits<R (__stdcall TheClass::*)(Args...)> : callable_signature<R, TheClass, Args...>
+	{ };
+
+	template<typename R, typename TheClass, typename... Args>
+	struct callable_traits<R (__stdcall TheClass::*)(Args...) const> : callable_signature<R, TheClass, Args...>
+	{ };
+#endif
+
+	namespace detail
+	{
+		// call the member function on the object
+		template<typename Function, typename TheClass, typename... Args>
+		inline auto callable_invoke(Function func, TheClass* theclass, Args&&... args) -> decltype((theclass->*func)(std::forward<Args>(args)...))
+		{
+			return (theclass->*func)(std::forward<Args>(args)...);
+		}
+
+		// call the non-member function, there is no object
+		template<typename Function, typename... Args>
+		inline auto callable_invoke(Function func, void*, Args&&... args) -> decltype(func(std::forward<Args>(args)...))
+		{
+			return func(std::forward<Args>(args)...);
+		}
+
+		// an lvalue for an lvalue reference parameter or an argument not owned by the call
+		template<typename Param, typename Arg>
+		struct passed_arg
+		{
+			typedef typename std::conditional<std::is_lvalue_reference<Param>::value || std::is_reference<Arg>::value, Arg&, Arg&&>::type type;
+		};
+
+		/**
+		* Pass the argument to the parameter, the argument owned by the call is moved into a by-value
+		* or an rvalue reference parameter. Arg is the type kept for the call, a reference isn't owned.
+		*/
+		template<typename Param, typename Arg>
+		inline typename passed_arg<Param, Arg>::type pass_arg(Arg& arg)
+		{
+			return static_cast<typename passed_arg<Param, Arg>::type>(arg);
+		}
+	}
+}
+
+#endif
@@ -67,17 +67,18 @@ namespace DT
 
 	#define REG_METHOD_ID(id,strName,func)		m_invoker.register_function(id,strName,&type::func,this);
 
-	#define REG_METHOD_NAME(strName,func)		REG_METHOD_ID( (DISPID)m_invoker.GetInvokerID(strName,false),strName,func);
+	// the names are literals, their IDs are compile time constants of the name_hash of IDispatchInterpreter
+	#define REG_METHOD_NAME(strName,func)		REG_METHOD_ID( (DISPID)DT_FUNCTION_ID(strName),strName,func);
 	#define REG_METHOD_DEFAULT(name,func)		m_defMethodID = (DISPID)REG_METHOD_NAME(name,func)
 	#define REG_METHOD(func)					REG_METHOD_NAME(#func,func)
 
-	#define REG_ATTR_BASE(strName)				getAttrName((DISPID)m_invoker.GetInvokerID(strName,false)) = L##strName;
-	#define REG_R_ATTR_NAME(strName,attr)		REG_ATTR_BASE(strName) getAttrReaderID((DISPID)m_invoker.GetInvokerID(strName,false))  = REG_METHOD_NAME(strName,get_##attr)
-	#define REG_W_ATTR_NAME(strName,attr)		REG_ATTR_BASE(strName) getAttrWriterID((DISPID)m_invoker.GetInvokerID(strName,false))  = REG_METHOD_NAME(strName "_W", put_##attr)
+	#define REG_ATTR_BASE(strName)				getAttrName((DISPID)DT_FUNCTION_ID(strName)) = L##strName;
+	#define REG_R_ATTR_NAME(strName,attr)		REG_ATTR_BASE(strName) getAttrReaderID((DISPID)DT_FUNCTION_ID(strName))  = REG_METHOD_NAME(strName,get_##attr)
+	#define REG_W_ATTR_NAME(strName,attr)		REG_ATTR_BASE(strName) getAttrWriterID((DISPID)DT_FUNCTION_ID(strName))  = REG_METHOD_NAME(strName "_W", put_##attr)
 
 	#define REG_ATTR_NAME(strName,attr)			REG_R_ATTR_NAME(strName,attr) REG_W_ATTR_NAME(strName,attr)
 
-	#define REG_ATTR_NAME_DEFAULT(strName,attr)	m_defMethodID = (DISPID)m_invoker.GetInvokerID(strName,false); REG_ATTR_NAME(strName,attr)
+	#define REG_ATTR_NAME_DEFAULT(strName,attr)	m_defMethodID = (DISPID)DT_FUNCTION_ID(strName); REG_ATTR_NAME(strName,attr)
 
 	#define REG_R_ATTR(attr)					REG_R_ATTR_NAME(#attr,attr)
 	#define REG_W_ATTR(attr)					REG_W_ATTR_NAME(#attr,attr)
@@ -89,7 +90,7 @@ namespace DT
 	#define END_INVOKER							}
 
 	typedef interpreter_param_parser<std::reverse_iterator<VARIANTARG*>> IDispatchParamTokenizer;
-	typedef interpreter<IDispatchParamTokenizer,HRESULT,std::hash<std::string>> IDispatchInterpreter;
+	typedef interpreter<IDispatchParamTokenizer,HRESULT,name_hash> IDispatchInterpreter;
 
 	template<>
 	template<>
@@ -0,0 +1,93 @@
+/**
+ * (C) Copyright 2013 Dreamer
+ *
+ * this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _DT_INLINE_FUNCTION_
+#define _DT_INLINE_FUNCTION_
+
+#include <new>
+#include <cstddef>
+#include <utility>
+#include <type_traits>
+
+namespace DT
+{
+	namespace detail
+	{
+		// never defined, the member function pointer of an unknown class has the most general layout
+		struct inline_function_unknown_class;
+	}
+
+	/**
+	* The default inline buffer size of inline_function. It fits an object pointer plus the
+	* biggest member function pointer the compiler generates.
+	*/
+	const size_t inline_function_buffer_size = sizeof(void*) + sizeof(void (detail::inline_function_unknown_class::*)());
+
+	/**
+	* A type-erased callable which keeps its target in an inline buffer instead of the heap. It
+	* replaces the boost::function + boost::bind combination for the interpreter invokers.
+	*
+	* The target must be trivially copyable and fit the buffer, it is checked at compile time. So
+	* the construction never allocates and a call is one indirect call through the thunk.
+	*/
+	template<typename Signature, size_t BufferSize = inline_function_buffer_size>
+	class inline_function;
+
+	template<typename R, typename... Args, size_t BufferSize>
+	class inline_function<R (Args...), BufferSize>
+	{
+		typedef R (*thunk_type)(void const*, Args...);
+		typedef typename std::aligned_storage<BufferSize>::type storage_type;
+
+	public:
+		typedef R result_type;
+
+		inline_function() : thunk(NULL)
+		{ }
+
+		template<typename Functor>
+		inline_function(Functor const& func) : thunk(&invoke_target<Functor>)
+		{
+			static_assert(sizeof(Functor) <= BufferSize, "the callable doesn't fit the inline_function buffer");
+			static_assert(std::alignment_of<Functor>::value <= std::alignment_of<storage_type>::value, "the callable is over aligned");
+			static_assert(std::is_trivially_copyable<Functor>::value, "the callable must be trivially copyable");
+
+			::new (static_cast<void*>(&storage)) Functor(func);
+		}
+
+		inline R operator()(Args... args) const
+		{
+			return thunk(&storage, std::forward<Args>(args)...);
+		}
+
+		inline bool empty() const
+		{
+			return thunk == NULL;
+		}
+
+	private:
+		template<typename Functor>
+		static R invoke_target(void const* pTarget, Args... args)
+		{
+			return (*static_cast<Functor const*>(pTarget))(std::forward<Args>(args)...);
+		}
+
+		thunk_type thunk;
+		storage_type storage;
+	};
+}
+
+#endif
@@ -0,0 +1,1137 @@
+/**
+ * (C) Copyright 2013 Dreamer
+ *
+ * this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+* The JSON-RPC 2.0 front end of an interpreter. json_rpc_server::handle() takes a request or a
+* batch of requests and writes the response text, the method of a request is the function name
+* and its params array is read by json_param_parser straight into the parameter types. A call
+* isn't turned into a text command for parse_input().
+*
+* The text is scanned once in place, no document tree is built. The strings are searched for
+* their quote 8 characters at a time, a string without escapes is a view of the request text.
+*
+* The host registers the functions in an interpreter<json_param_parser> and exposes them to the
+* server with their result types. json_codec reads and writes the arithmetic types, the strings,
+* std::string_view and std::vector; specialize it for the others. The params by name aren't
+* supported, the params array has a value for every parameter and null is its default value.
+*
+*	interpreter<json_param_parser> interp;
+*	json_rpc_server< interpreter<json_param_parser> > server(interp);
+*	server.register_function("add", &add);
+*	server.handle("[{\"jsonrpc\":\"2.0\",\"method\":\"add\",\"params\":[1,2],\"id\":1}]");
+*/
+
+#ifndef _DT_JSON_RPC_
+#define _DT_JSON_RPC_
+
+#include <cstddef>
+#include <cstring>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <typeinfo>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+
+#include "Interpreter.hpp"
+#include "token_cast.hpp"
+#include "tuple_codec.hpp"
+
+#ifdef __cpp_lib_string_view
+#include <string_view>
+#endif
+
+namespace DT
+{
+	/** the error codes of JSON-RPC 2.0, json_rpc_server_error is the exception of a function */
+	enum json_rpc_errc
+	{
+		json_rpc_parse_error = -32700,
+		json_rpc_invalid_request = -32600,
+		json_rpc_method_not_found = -32601,
+		json_rpc_invalid_params = -32602,
+		json_rpc_internal_error = -32603,
+		json_rpc_server_error = -32000
+	};
+
+	namespace detail
+	{
+		inline char const* json_skip_space(char const* p, char const* pEnd)
+		{
+			while(p != pEnd && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t'))
+				p++;
+
+			return p;
+		}
+
+		// the first quote, backslash or control character, 8 characters at a time
+		inline char const* json_string_stop(char const* p, char const* pEnd)
+		{
+			const boost::uint64_t ones = 0x0101010101010101ULL;
+			const boost::uint64_t highs = 0x8080808080808080ULL;
+
+			while(pEnd - p >= 8)
+			{
+				boost::uint64_t nWord;
+				std::memcpy(&nWord, p, sizeof(nWord));
+
+				boost::uint64_t nQuote = nWord ^ (ones * '"');
+				boost::uint64_t nSlash = nWord ^ (ones * '\\');
+				boost::uint64_t nFound = ((nQuote - ones) & ~nQuote) | ((nSlash - ones) & ~nSlash) | ((nWord - ones * 0x20) & ~nWord);
+
+				if((nFound & highs) != 0)
+					break;
+
+				p += 8;
+			}
+
+			while(p != pEnd && *p != '"' && *p != '\\' && (unsigned char)*p >= 0x20)
+				p++;
+
+			return p;
+		}
+
+		/** the raw characters of the string at p, bEscaped tells whether they need json_unescape() */
+		inline bool json_scan_string(char const*& p, char const* pEnd, char const*& pRaw, char const*& pRawEnd, bool& bEscaped)
+		{
+			if(p == pEnd || *p != '"')
+				return false;
+
+			char const* pAt = p + 1;
+			bEscaped = false;
+
+			for(;;)
+			{
+				pAt = json_string_stop(pAt, pEnd);
+
+				if(pAt == pEnd || (unsigned char)*pAt < 0x20)
+					return false;
+
+				if(*pAt == '"')
+					break;
+
+				// a backslash and the escaped character
+				bEscaped = true;
+				pAt += 2;
+
+				if(pAt > pEnd)
+					return false;
+			}
+
+			pRaw = p + 1;
+			pRawEnd = pAt;
+			p = pAt + 1;
+			return true;
+		}
+
+		inline int json_hex(char c)
+		{
+			if(c >= '0' && c <= '9') return c - '0';
+			if(c >= 'a' && c <= 'f') return c - 'a' + 10;
+			if(c >= 'A' && c <= 'F') return c - 'A' + 10;
+			return -1;
+		}
+
+		inline bool json_code_unit(char const*& p, char const* pEnd, boost::uint32_t& nUnit)
+		{
+			if(pEnd - p < 4)
+				return false;
+
+			nUnit = 0;
+			for(int i = 0; i < 4; i++)
+			{
+				int nDigit = json_hex(p[i]);
+
+				if(nDigit < 0)
+					return false;
+
+				nUnit = (nUnit << 4) | (boost::uint32_t)nDigit;
+			}
+
+			p += 4;
+			return true;
+		}
+
+		template<typename String>
+		inline void json_append_utf8(String& value, boost::uint32_t nCode)
+		{
+			if(nCode < 0x80)
+				value += (char)nCode;
+			else if(nCode < 0x800)
+			{
+				value += (char)(0xc0 | (nCode >> 6));
+				value += (char)(0x80 | (nCode & 0x3f));
+			}
+			else if(nCode < 0x10000)
+			{
+				value += (char)(0xe0 | (nCode >> 12));
+				value += (char)(0x80 | ((nCode >> 6) & 0x3f));
+				value += (char)(0x80 | (nCode & 0x3f));
+			}
+			else
+			{
+				value += (char)(0xf0 | (nCode >> 18));
+				value += (char)(0x80 | ((nCode >> 12) & 0x3f));
+				value += (char)(0x80 | ((nCode >> 6) & 0x3f));
+				value += (char)(0x80 | (nCode & 0x3f));
+			}
+		}
+
+		/** the raw characters of a string with the escapes resolved, \u is written as UTF-8 */
+		template<typename String>
+		inline bool json_unescape(char const* p, char const* pEnd, String& value)
+		{
+			value.clear();
+
+			while(p != pEnd)
+			{
+				char const* pStop = json_string_stop(p, pEnd);
+
+				value.append(p, pStop);
+				p = pStop;
+
+				if(p == pEnd)
+					break;
+
+				if(*p != '\\' || ++p == pEnd)
+					return false;
+
+				char c = *p++;
+
+				switch(c)
+				{
+				case '"': case '\\': case '/': value += c; break;
+				case 'b': value += '\b'; break;
+				case 'f': value += '\f'; break;
+				case 'n': value += '\n'; break;
+				case 'r': value += '\r'; break;
+				case 't': value += '\t'; break;
+				case 'u':
+				{
+					boost::uint32_t nCode, nLow;
+
+					if(!json_code_unit(p, pEnd, nCode))
+						return false;
+
+					// a surrogate pair is one code point
+					if(nCode >= 0xd800 && nCode < 0xdc00)
+					{
+						if(pEnd - p < 2 || p[0] != '\\' || p[1] != 'u')
+							return false;
+
+						p += 2;
+
+						if(!json_code_unit(p, pEnd, nLow) || nLow < 0xdc00 || nLow >= 0xe000)
+							return false;
+
+						nCode = 0x10000 + ((nCode - 0xd800) << 10) + (nLow - 0xdc00);
+					}
+					else if(nCode >= 0xdc00 && nCode < 0xe000)
+						return false;
+
+					json_append_utf8(value, nCode);
+					break;
+				}
+				default:
+					return false;
+				}
+			}
+
+			return true;
+		}
+
+		inline void json_write_string(std::string& out, char const* p, char const* pEnd)
+		{
+			static const char hex[] = "0123456789abcdef";
+
+			out += '"';
+
+			while(p != pEnd)
+			{
+				char const* pStop = json_string_stop(p, pEnd);
+
+				out.append(p, pStop);
+				p = pStop;
+
+				if(p == pEnd)
+					break;
+
+				char c = *p++;
+
+				switch(c)
+				{
+				case '"': out += "\\\""; break;
+				case '\\': out += "\\\\"; break;
+				case '\n': out += "\\n"; break;
+				case '\r': out += "\\r"; break;
+				case '\t': out += "\\t"; break;
+				default:
+					out += "\\u00";
+					out += hex[(unsigned char)c >> 4];
+					out += hex[(unsigned char)c & 0xf];
+				}
+			}
+
+			out += '"';
+		}
+
+		inline bool json_is_literal(char const*& p, char const* pEnd, char const* szLiteral, size_t nLength)
+		{
+			if((size_t)(pEnd - p) < nLength || std::memcmp(p, szLiteral, nLength) != 0)
+				return false;
+
+			p += nLength;
+			return true;
+		}
+
+		inline char const* json_digits_end(char const* p, char const* pEnd)
+		{
+			while(p != pEnd && *p >= '0' && *p <= '9')
+				p++;
+
+			return p;
+		}
+
+		/** the end of the number at p by the JSON grammar, p itself if there is none */
+		inline char const* json_number_end(char const* p, char const* pEnd)
+		{
+			char const* pAt = p != pEnd && *p == '-' ? p + 1 : p;
+			char const* pDigits = pAt;
+
+			if(pAt != pEnd && *pAt == '0')
+				pAt++;
+			else
+				pAt = json_digits_end(pAt, pEnd);
+
+			if(pAt == pDigits)
+				return p;
+
+			if(pAt != pEnd && *pAt == '.')
+			{
+				pDigits = ++pAt;
+				pAt = json_digits_end(pAt, pEnd);
+
+				if(pAt == pDigits)
+					return p;
+			}
+
+			if(pAt != pEnd && (*pAt == 'e' || *pAt == 'E'))
+			{
+				if(++pAt != pEnd && (*pAt == '+' || *pAt == '-'))
+					pAt++;
+
+				pDigits = pAt;
+				pAt = json_digits_end(pAt, pEnd);
+
+				if(pAt == pDigits)
+					return p;
+			}
+
+			return pAt;
+		}
+
+		/** the nesting limit of the arrays and the objects, a deeper request isn't accepted */
+		const size_t json_max_depth = 256;
+
+		inline bool json_skip_value(char const*& p, char const* pEnd, size_t nDepth = 0);
+
+		// the members or the elements up to the closing bracket, their separators are checked
+		inline bool json_skip_container(char const*& p, char const* pEnd, size_t nDepth)
+		{
+			char const* pRaw;
+			char const* pRawEnd;
+			bool bEscaped;
+			bool bObject = *p++ == '{';
+
+			p = json_skip_space(p, pEnd);
+
+			if(p != pEnd && *p == (bObject ? '}' : ']'))
+			{
+				p++;
+				return true;
+			}
+
+			for(;;)
+			{
+				if(bObject)
+				{
+					if(!json_scan_string(p, pEnd, pRaw, pRawEnd, bEscaped))
+						return false;
+
+					p = json_skip_space(p, pEnd);
+
+					if(p == pEnd || *p++ != ':')
+						return false;
+
+					p = json_skip_space(p, pEnd);
+				}
+
+				if(!json_skip_value(p, pEnd, nDepth))
+					return false;
+
+				p = json_skip_space(p, pEnd);
+
+				if(p == pEnd)
+					return false;
+
+				if(*p++ == (bObject ? '}' : ']'))
+					return true;
+
+				if(p[-1] != ',')
+					return false;
+
+				p = json_skip_space(p, pEnd);
+			}
+		}
+
+		/** skip a value, it fails for a value which isn't valid JSON */
+		inline bool json_skip_value(char const*& p, char const* pEnd, size_t nDepth)
+		{
+			char const* pRaw;
+			char const* pRawEnd;
+			bool bEscaped;
+
+			if(p == pEnd)
+				return false;
+
+			if(*p == '"')
+				return json_scan_string(p, pEnd, pRaw, pRawEnd, bEscaped);
+
+			if(*p == '[' || *p == '{')
+				return nDepth < json_max_depth && json_skip_container(p, pEnd, nDepth + 1);
+
+			if(json_is_literal(p, pEnd, "true", 4) || json_is_literal(p, pEnd, "false", 5) || json_is_literal(p, pEnd, "null", 4))
+				return true;
+
+			char const* pNumber = json_number_end(p, pEnd);
+
+			if(pNumber == p)
+				return false;
+
+			p = pNumber;
+			return true;
+		}
+	}
+
+	/**
+	* Read and write the JSON values of the type T. read() is called at a value which isn't null
+	* and returns false if the value isn't of the type, write() appends the value.
+	*/
+	template<typename T, typename Enable = void>
+	struct json_codec
+	{
+		static_assert(sizeof(T) == 0, "specialize DT::json_codec for the parameter or the result type");
+	};
+
+	template<>
+	struct json_codec<bool>
+	{
+		static inline bool read(char const*& p, char const* pEnd, bool& bValue)
+		{
+			if(detail::json_is_literal(p, pEnd, "true", 4))
+				bValue = true;
+			else if(detail::json_is_literal(p, pEnd, "false", 5))
+				bValue = false;
+			else
+				return false;
+
+			return true;
+		}
+
+		static inline void write(std::string& out, bool bValue)
+		{
+			out += bValue ? "true" : "false";
+		}
+	};
+
+	/** the numbers are converted by token_cast and written like tuple_codec, NaN and Inf are null */
+	template<typename T>
+	struct json_codec<T, typename std::enable_if<std::is_arithmetic<T>::value && !std::is_same<T, bool>::value>::type>
+	{
+		static inline bool read(char const*& p, char const* pEnd, T& value)
+		{
+			char const* pNumber = detail::json_number_end(p, pEnd);
+
+			if(pNumber == p || !try_token_cast(p, pNumber, value))
+				return false;
+
+			p = pNumber;
+			return true;
+		}
+
+		static inline void write(std::string& out, T value)
+		{
+			if(!is_finite(value, std::is_floating_point<T>()))
+			{
+				out += "null";
+				return;
+			}
+
+			size_t nSize = out.size();
+
+			out.resize(nSize + field_codec<T, char>::max_size(value));
+			out.resize(field_codec<T, char>::format(value, &out[nSize]) - out.data());
+		}
+
+	private:
+		static inline bool is_finite(T value, std::true_type)
+		{
+			return std::isfinite(value);
+		}
+
+		static inline bool is_finite(T, std::false_type)
+		{
+			return true;
+		}
+	};
+
+	template<typename Traits, typename Alloc>
+	struct json_codec< std::basic_string<char,Traits,Alloc> >
+	{
+		static inline bool read(char const*& p, char const* pEnd, std::basic_string<char,Traits,Alloc>& value)
+		{
+			char const* pAt = p;
+			char const* pRaw;
+			char const* pRawEnd;
+			bool bEscaped;
+
+			if(!detail::json_scan_string(pAt, pEnd, pRaw, pRawEnd, bEscaped))
+				return false;
+
+			if(bEscaped)
+			{
+				if(!detail::json_unescape(pRaw, pRawEnd, value))
+					return false;
+			}
+			else
+				value.assign(pRaw, pRawEnd);
+
+			p = pAt;
+			return true;
+		}
+
+		static inline void write(std::string& out, std::basic_string<char,Traits,Alloc> const& value)
+		{
+			detail::json_write_string(out, value.data(), value.data() + value.size());
+		}
+	};
+
+	template<>
+	struct json_codec<char const*>
+	{
+		static inline void write(std::string& out, char const* szValue)
+		{
+			detail::json_write_string(out, szValue, szValue + std::strlen(szValue));
+		}
+	};
+
+#ifdef __cpp_lib_string_view
+	/** the view refers into the request text, so a string with escapes isn't a string_view */
+	template<typename Traits>
+	struct json_codec< std::basic_string_view<char,Traits> >
+	{
+		static inline bool read(char const*& p, char const* pEnd, std::basic_string_view<char,Traits>& value)
+		{
+			char const* pAt = p;
+			char const* pRaw;
+			char const* pRawEnd;
+			bool bEscaped;
+
+			if(!detail::json_scan_string(pAt, pEnd, pRaw, pRawEnd, bEscaped) || bEscaped)
+				return false;
+
+			value = std::basic_string_view<char,Traits>(pRaw, (size_t)(pRawEnd - pRaw));
+			p = pAt;
+			return true;
+		}
+
+		static inline void write(std::string& out, std::basic_string_view<char,Traits> const& value)
+		{
+			detail::json_write_string(out, value.data(), value.data() + value.size());
+		}
+	};
+#endif
+
+	/** an array of the values */
+	template<typename T, typename Alloc>
+	struct json_codec< std::vector<T,Alloc> >
+	{
+		static inline bool read(char const*& p, char const* pEnd, std::vector<T,Alloc>& value)
+		{
+			char const* pAt = p;
+
+			if(pAt == pEnd || *pAt++ != '[')
+				return false;
+
+			value.clear();
+			pAt = detail::json_skip_space(pAt, pEnd);
+
+			if(pAt != pEnd && *pAt == ']')
+			{
+				p = pAt + 1;
+				return true;
+			}
+
+			for(;;)
+			{
+				value.push_back(detail::token_value<T>::make());
+
+				if(!read_element(pAt, pEnd, value.back()))
+					return false;
+
+				pAt = detail::json_skip_space(pAt, pEnd);
+
+				if(pAt == pEnd)
+					return false;
+
+				if(*pAt == ']')
+					break;
+
+				if(*pAt++ != ',')
+					return false;
+
+				pAt = detail::json_skip_space(pAt, pEnd);
+			}
+
+			p = pAt + 1;
+			return true;
+		}
+
+		static inline void write(std::string& out, std::vector<T,Alloc> const& value)
+		{
+			out += '[';
+
+			for(size_t i = 0; i < value.size(); i++)
+			{
+				if(i > 0)
+					out += ',';
+
+				json_codec<T>::write(out, value[i]);
+			}
+
+			out += ']';
+		}
+
+	private:
+		static inline bool read_element(char const*& p, char const* pEnd, T& element)
+		{
+			if(detail::json_is_literal(p, pEnd, "null", 4))
+				return true;
+
+			return json_codec<T>::read(p, pEnd, element);
+		}
+	};
+
+	/**
+	* The parser of the elements of a params array, it is the text between the brackets. The params
+	* must match the parameters, the server reports the params left after the call.
+	*/
+	class json_param_parser
+	{
+	public:
+		json_param_parser(char const* pBegin, char const* pEnd)
+			: pAt(pBegin), pEnd(pEnd), nRead(0)
+		{ }
+
+		/** \throw std::runtime_error if the argument isn't of the type */
+		template<typename RequestedType>
+		typename std::decay<RequestedType>::type get()
+		{
+			bool bOk = false;
+			typename std::decay<RequestedType>::type value = try_get<RequestedType>(bOk);
+
+			if(!bOk)
+				throw std::runtime_error("invalid argument: the JSON value isn't " + std::string(typeid(value).name()));
+
+			return value;
+		}
+
+		/** null is the default value, a missing argument isn't */
+		template<typename RequestedType>
+		typename std::decay<RequestedType>::type try_get(bool & bOk)
+		{
+			typedef typename std::decay<RequestedType>::type value_type;
+			value_type value = detail::token_value<value_type>::make();
+
+			bOk = false;
+			pAt = detail::json_skip_space(pAt, pEnd);
+
+			if(pAt == pEnd || (nRead > 0 && *pAt++ != ','))
+				return value;
+
+			nRead++;
+			bOk = true;
+			pAt = detail::json_skip_space(pAt, pEnd);
+
+			if(!detail::json_is_literal(pAt, pEnd, "null", 4))
+				bOk = json_codec<value_type>::read(pAt, pEnd, value);
+
+			return value;
+		}
+
+		inline bool has_more_tokens() const
+		{
+			return detail::json_skip_space(pAt, pEnd) != pEnd;
+		}
+
+		/** the count of the params read */
+		inline size_t read_count() const
+		{
+			return nRead;
+		}
+
+	private:
+		char const* pAt;
+		char const* pEnd;
+		size_t nRead;
+	};
+
+	/**
+	* Serve the JSON-RPC 2.0 requests by the interpreter. handle() is called by any number of
+	* threads once the functions are exposed.
+	*/
+	template<typename Interpreter>
+	class json_rpc_server
+	{
+		typedef bool (*call_function)(Interpreter&, size_t, json_param_parser&, std::string&, invoker_error&);
+
+		struct method
+		{
+			size_t fnID;
+			call_function call;
+		};
+
+	public:
+		explicit json_rpc_server(Interpreter& interp)
+			: interp(interp)
+		{ }
+
+		/**
+		* Expose the registered function by its name, R is its return type or the value type of its
+		* future.
+		*
+		* \return false if the function isn't registered
+		*/
+		template<typename R>
+		bool expose(size_t fnID)
+		{
+			std::string const& name = interp.GetInvokerName(fnID);
+
+			if(name.empty())
+				return false;
+
+			method m = {fnID, &call_typed<R>};
+			methods[name] = m;
+			return true;
+		}
+
+		/** register the function into the interpreter and expose it */
+		template<typename Function>
+		size_t register_function(std::string const & name, Function f)
+		{
+			size_t fnID = interp.register_function(name, f);
+
+			expose<typename detail::result_value<typename callable_traits<Function>::result_type>::type>(fnID);
+			return fnID;
+		}
+
+		/**
+		* Call the request or the batch of requests and append the response to the output.
+		*
+		* \return false if there is no response, the request is a notification or a batch of them
+		*/
+		bool handle(char const* pRequest, size_t nLength, std::string& response)
+		{
+			char const* p = detail::json_skip_space(pRequest, pRequest + nLength);
+			char const* pEnd = pRequest + nLength;
+			size_t nMark = response.size();
+
+			if(p != pEnd && *p == '[')
+			{
+				if(!handle_batch(p, pEnd, response))
+				{
+					response.resize(nMark);
+					write_error(response, NULL, NULL, json_rpc_parse_error, "parse error");
+				}
+			}
+			else if(!handle_call(p, pEnd, response))
+			{
+				response.resize(nMark);
+				write_error(response, NULL, NULL, json_rpc_parse_error, "parse error");
+			}
+
+			return response.size() != nMark;
+		}
+
+		/** \return the response, it is empty if there is no response */
+		inline std::string handle(std::string const& request)
+		{
+			std::string response;
+
+			handle(request.data(), request.size(), response);
+			return response;
+		}
+
+	private:
+		// a request is parsed before it is called, the pointers refer into the request text
+		struct request
+		{
+			char const* pId;
+			char const* pIdEnd;
+			char const* pParams;
+			char const* pParamsEnd;
+			std::string strMethod;
+			bool bObject;
+			bool bValid;
+
+			request() : pId(NULL), pIdEnd(NULL), pParams(NULL), pParamsEnd(NULL), bObject(false), bValid(false)
+			{ }
+		};
+
+		// false for a text which isn't JSON, the whole batch is a parse error then and none of it is called
+		bool handle_batch(char const*& p, char const* pEnd, std::string& response)
+		{
+			std::vector<request> requests;
+
+			p = detail::json_skip_space(p + 1, pEnd);
+
+			if(p != pEnd && *p == ']')
+			{
+				if(detail::json_skip_space(p + 1, pEnd) != pEnd)
+					return false;
+
+				write_error(response, NULL, NULL, json_rpc_invalid_request, "empty batch");
+				return true;
+			}
+
+			for(;;)
+			{
+				requests.push_back(request());
+
+				if(!parse_request(p, pEnd, requests.back()))
+					return false;
+
+				p = detail::json_skip_space(p, pEnd);
+
+				if(p == pEnd)
+					return false;
+
+				if(*p == ']')
+					break;
+
+				if(*p++ != ',')
+					return false;
+
+				p = detail::json_skip_space(p, pEnd);
+			}
+
+			if(detail::json_skip_space(p + 1, pEnd) != pEnd)
+				return false;
+
+			size_t nMark = response.size();
+
+			response += '[';
+
+			for(size_t i = 0; i < requests.size(); i++)
+			{
+				size_t nCall = response.size();
+
+				if(response.size() > nMark + 1)
+					response += ',';
+
+				//a notification leaves the separator only
+				if(!answer(requests[i], response))
+					response.resize(nCall);
+			}
+
+			if(response.size() == nMark + 1)
+				response.resize(nMark);
+			else
+				response += ']';
+
+			return true;
+		}
+
+		bool handle_call(char const*& p, char const* pEnd, std::string& response)
+		{
+			request req;
+
+			if(!parse_request(p, pEnd, req) || detail::json_skip_space(p, pEnd) != pEnd)
+				return false;
+
+			answer(req, response);
+			return true;
+		}
+
+		// false for a text which isn't JSON
+		bool parse_request(char const*& p, char const* pEnd, request& req)
+		{
+			if(p == pEnd)
+				return false;
+
+			if(*p != '{')
+				return detail::json_skip_value(p, pEnd);
+
+			char const* pAt = detail::json_skip_space(p + 1, pEnd);
+			bool bVersion = false, bMethod = false, bId = true;
+
+			if(pAt != pEnd && *pAt == '}')
+				pAt++;
+			else
+			{
+				for(;;)
+				{
+					char const* pKey;
+					char const* pKeyEnd;
+					bool bEscaped;
+
+					if(!detail::json_scan_string(pAt, pEnd, pKey, pKeyEnd, bEscaped))
+						return false;
+
+					pAt = detail::json_skip_space(pAt, pEnd);
+
+					if(pAt == pEnd || *pAt++ != ':')
+						return false;
+
+					pAt = detail::json_skip_space(pAt, pEnd);
+					char const* pMember = pAt;
+
+					if(!detail::json_skip_value(pAt, pEnd))
+						return false;
+
+					switch(member_key(pKey, pKeyEnd, bEscaped))
+					{
+					case key_version:
+						bVersion = (pAt - pMember == 5 && std::memcmp(pMember, "\"2.0\"", 5) == 0) || is_version(pMember, pAt);
+						break;
+					case key_method:
+						bMethod = json_codec<std::string>::read(pMember, pAt, req.strMethod);
+						break;
+					case key_params:
+						req.pParams = pMember;
+						req.pParamsEnd = pAt;
+						break;
+					case key_id:
+						req.pId = pMember;
+						req.pIdEnd = pAt;
+						bId = *pMember != '[' && *pMember != '{' && *pMember != 't' && *pMember != 'f';
+						break;
+					default:
+						break;
+					}
+
+					pAt = detail::json_skip_space(pAt, pEnd);
+
+					if(pAt == pEnd)
+						return false;
+
+					if(*pAt == '}')
+						break;
+
+					if(*pAt++ != ',')
+						return false;
+
+					pAt = detail::json_skip_space(pAt, pEnd);
+				}
+
+				pAt++;
+			}
+
+			p = pAt;
+			req.bObject = true;
+			req.bValid = bVersion && bMethod && bId;
+
+			//the id of an invalid type isn't echoed
+			if(!bId)
+				req.pId = req.pIdEnd = NULL;
+
+			return true;
+		}
+
+		// \return false if there is no response, the request is a notification
+		bool answer(request const& req, std::string& response)
+		{
+			if(!req.bObject)
+			{
+				write_error(response, NULL, NULL, json_rpc_invalid_request, "the request isn't an object");
+				return true;
+			}
+
+			if(!req.bValid)
+			{
+				write_error(response, req.pId, req.pIdEnd, json_rpc_invalid_request, "invalid request");
+				return true;
+			}
+
+			// a notification has no response, even for an error
+			size_t nMark = response.size();
+
+			call(req.strMethod, req.pParams, req.pParamsEnd, req.pId, req.pIdEnd, response);
+
+			if(req.pId != NULL)
+				return true;
+
+			response.resize(nMark);
+			return false;
+		}
+
+		enum member
+		{
+			key_other,
+			key_version,
+			key_method,
+			key_params,
+			key_id
+		};
+
+		// the version with escapes
+		static bool is_version(char const* p, char const* pEnd)
+		{
+			std::string strVersion;
+
+			return json_codec<std::string>::read(p, pEnd, strVersion) && strVersion == "2.0";
+		}
+
+		// the raw key is compared, a key with escapes is compared once they are resolved
+		static member member_key(char const* pKey, char const* pKeyEnd, bool bEscaped)
+		{
+			std::string key;
+
+			if(bEscaped)
+			{
+				if(!detail::json_unescape(pKey, pKeyEnd, key))
+					return key_other;
+
+				pKey = key.data();
+				pKeyEnd = key.data() + key.size();
+			}
+
+			switch(pKeyEnd - pKey)
+			{
+			case 2: return std::memcmp(pKey, "id", 2) == 0 ? key_id : key_other;
+			case 6: return std::memcmp(pKey, "method", 6) == 0 ? key_method : (std::memcmp(pKey, "params", 6) == 0 ? key_params : key_other);
+			case 7: return std::memcmp(pKey, "jsonrpc", 7) == 0 ? key_version : key_other;
+			default: return key_other;
+			}
+		}
+
+		void call(std::string const& strMethod, char const* pParams, char const* pParamsEnd, char const* pId, char const* pIdEnd, std::string& response)
+		{
+			typename std::unordered_map<std::string, method>::const_iterator itr = methods.find(strMethod);
+
+			if(itr == methods.end())
+			{
+				write_error(response, pId, pIdEnd, json_rpc_method_not_found, "method not found");
+				return;
+			}
+
+			if(pParams != NULL && *pParams != '[')
+			{
+				write_error(response, pId, pIdEnd, json_rpc_invalid_params, "the params aren't an array");
+				return;
+			}
+
+			// the parser reads the text between the brackets
+			json_param_parser parser(pParams != NULL ? pParams + 1 : pParams, pParams != NULL ? pParamsEnd - 1 : pParamsEnd);
+			size_t nMark = response.size();
+			invoker_error err = {invoker_ok, itr->second.fnID, 0};
+
+			write_head(response, pId, pIdEnd);
+			response += ",\"result\":";
+
+			try
+			{
+				if(itr->second.call(interp, itr->second.fnID, parser, response, err))
+				{
+					if(!parser.has_more_tokens())
+					{
+						response += '}';
+						return;
+					}
+
+					//the function doesn't take the rest, the index is the first extra param
+					err.code = invoker_invalid_argument;
+					err.arg_index = parser.read_count();
+				}
+			}
+			catch(std::exception& e)
+			{
+				response.resize(nMark);
+				write_error(response, pId, pIdEnd, json_rpc_server_error, e.what());
+				return;
+			}
+
+			response.resize(nMark);
+
+			if(err.code == invoker_invalid_argument)
+				write_error(response, pId, pIdEnd, json_rpc_invalid_params, "invalid params", &err.arg_index);
+			else
+				write_error(response, pId, pIdEnd, json_rpc_internal_error, "internal error");
+		}
+
+		template<typename R>
+		static bool call_typed(Interpreter& interp, size_t fnID, json_param_parser& parser, std::string& response, invoker_error& err)
+		{
+			invoker_result<R> result = interp.template TryExecInvoker<R>(fnID, parser);
+
+			if(!result)
+			{
+				err = result.error();
+				return false;
+			}
+
+			json_codec<R>::write(response, result.value());
+			return true;
+		}
+
+		// the id is copied from the request, it is null if the request has none
+		static void write_head(std::string& response, char const* pId, char const* pIdEnd)
+		{
+			response += "{\"jsonrpc\":\"2.0\",\"id\":";
+
+			if(pId != NULL)
+				response.append(pId, pIdEnd);
+			else
+				response += "null";
+		}
+
+		static void write_error(std::string& response, char const* pId, char const* pIdEnd, json_rpc_errc code, char const* szMessage, size_t const* pArgIndex = NULL)
+		{
+			write_head(response, pId, pIdEnd);
+			response += ",\"error\":{\"code\":";
+			json_codec<int>::write(response, (int)code);
+			response += ",\"message\":";
+			json_codec<char const*>::write(response, szMessage);
+
+			if(pArgIndex != NULL)
+			{
+				response += ",\"data\":{\"index\":";
+				json_codec<size_t>::write(response, *pArgIndex);
+				response += '}';
+			}
+
+			response += "}}";
+		}
+
+		Interpreter& interp;
+		std::unordered_map<std::string, method> methods;
+	};
+}
+
+#endif
@@ -0,0 +1,150 @@
+/**
+ * (C) Copyright 2013 Dreamer
+ *
+ * this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+* A read-only memory-mapped file. The pages are read by the OS when they are touched, so a
+* script of several GB is tokenized from the mapping without being loaded first.
+*/
+
+#ifndef _DT_MAPPED_FILE_
+#define _DT_MAPPED_FILE_
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "token_stream.hpp"
+
+namespace DT
+{
+	class mapped_file
+	{
+	public:
+		/** \throw std::runtime_error if the file can't be opened or mapped */
+		explicit mapped_file(std::string const& strPath)
+			: pData(NULL), nSize(0)
+		{
+#ifdef _WIN32
+			HANDLE hFile = ::CreateFileA(strPath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+			LARGE_INTEGER size;
+
+			if(hFile == INVALID_HANDLE_VALUE)
+				throw std::runtime_error("can't open the file " + strPath);
+
+			if(!::GetFileSizeEx(hFile, &size))
+			{
+				::CloseHandle(hFile);
+				throw std::runtime_error("can't get the size of the file " + strPath);
+			}
+
+			nSize = (size_t)size.QuadPart;
+
+			if(nSize > 0)
+			{
+				HANDLE hMapping = ::CreateFileMappingA(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+
+				if(hMapping != NULL)
+				{
+					pData = ::MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+					::CloseHandle(hMapping);
+				}
+			}
+
+			::CloseHandle(hFile);
+#else
+			int fd = ::open(strPath.c_str(), O_RDONLY);
+			struct stat status;
+
+			if(fd < 0)
+				throw std::runtime_error("can't open the file " + strPath);
+
+			if(::fstat(fd, &status) != 0)
+			{
+				::close(fd);
+				throw std::runtime_error("can't get the size of the file " + strPath);
+			}
+
+			nSize = (size_t)status.st_size;
+
+			if(nSize > 0)
+			{
+				void* pMapped = ::mmap(NULL, nSize, PROT_READ, MAP_PRIVATE, fd, 0);
+
+				if(pMapped != MAP_FAILED)
+				{
+					pData = pMapped;
+					::madvise(pMapped, nSize, MADV_SEQUENTIAL);
+				}
+			}
+
+			::close(fd);
+#endif
+
+			if(nSize > 0 && pData == NULL)
+				throw std::runtime_error("can't map the file " + strPath);
+		}
+
+		~mapped_file()
+		{
+			if(pData == NULL)
+				return;
+
+#ifdef _WIN32
+			::UnmapViewOfFile(pData);
+#else
+			::munmap(pData, nSize);
+#endif
+		}
+
+		inline char const* data() const
+		{
+			return static_cast<char const*>(pData);
+		}
+
+		/** the size in bytes */
+		inline size_t size() const
+		{
+			return nSize;
+		}
+
+		/** the script of the file for the streaming parse_input(), Char is the encoding of the file */
+		template<typename Char>
+		inline token_stream<Char> tokens() const
+		{
+			Char const* pBegin = static_cast<Char const*>(pData);
+
+			return token_stream<Char>(pBegin, pBegin + nSize / sizeof(Char));
+		}
+
+	private:
+		mapped_file(mapped_file const&);
+		mapped_file& operator=(mapped_file const&);
+
+		void* pData;
+		size_t nSize;
+	};
+}
+
+#endif
@@ -0,0 +1,195 @@
+/**
+ * (C) Copyright 2013 Dreamer
+ *
+ * this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+* The bounded result cache of the pure interpreter functions. It is a CLOCK cache, a hit only
+* sets the reference bit of the entry, and a full cache replaces the first entry which isn't
+* referenced since the clock hand passed it last time.
+*/
+
+#ifndef _DT_MEMO_CACHE_
+#define _DT_MEMO_CACHE_
+
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+
+namespace DT
+{
+	/** the counters of a memo_cache */
+	struct memo_stats
+	{
+		boost::uint64_t hits;
+		boost::uint64_t misses;
+		size_t size;
+		size_t capacity;
+
+		memo_stats() : hits(0), misses(0), size(0), capacity(0)
+		{ }
+	};
+
+	/** hash a tuple by std::hash of its elements */
+	template<typename Tuple>
+	struct tuple_hash
+	{
+		inline size_t operator()(Tuple const& key) const
+		{
+			return combine(key, std::make_index_sequence<std::tuple_size<Tuple>::value>());
+		}
+
+		template<size_t... Is>
+		static inline size_t combine(Tuple const& key, std::index_sequence<Is...>)
+		{
+			size_t seed = 0;
+			size_t hashes[] = { 0, std::hash<typename std::tuple_element<Is, Tuple>::type>()(std::get<Is>(key))... };
+
+			for(size_t i = 1; i < sizeof(hashes) / sizeof(hashes[0]); i++)
+				seed ^= hashes[i] + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+
+			return seed;
+		}
+	};
+
+	/** the cache is synchronized, a hit copies the value out under the lock */
+	template<typename Key, typename Value, typename KeyHash = std::hash<Key> >
+	class memo_cache
+	{
+		typedef std::unordered_map<Key, size_t, KeyHash> key_index;
+
+		struct slot
+		{
+			// the key lives in the index, its node doesn't move
+			Key const* pKey;
+			Value value;
+			bool bReferenced;
+
+			slot(Key const* p, Value const& v) : pKey(p), value(v), bReferenced(false)
+			{ }
+		};
+
+	public:
+		typedef Key key_type;
+		typedef Value value_type;
+
+		explicit memo_cache(size_t nCapacity)
+			: nCapacity(nCapacity > 0 ? nCapacity : 1), nHand(0), nHits(0), nMisses(0)
+		{ }
+
+		/**
+		* Hand the cached value of the key to the visitor, it is called under the lock.
+		*
+		* \return false if the key isn't cached
+		*/
+		template<typename Visitor>
+		bool visit(Key const& key, Visitor const& visitor)
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			typename key_index::const_iterator itr = index.find(key);
+
+			if(itr == index.end())
+			{
+				nMisses++;
+				return false;
+			}
+
+			nHits++;
+			slots[itr->second].bReferenced = true;
+			visitor(static_cast<Value const&>(slots[itr->second].value));
+
+			return true;
+		}
+
+		/** cache the value, a key cached by another thread meanwhile is kept */
+		inline void insert(Key&& key, Value const& value)
+		{
+			put(std::move(key), value, false);
+		}
+
+		/** cache the value, it replaces the cached value of the key */
+		inline void insert_or_assign(Key&& key, Value const& value)
+		{
+			put(std::move(key), value, true);
+		}
+
+		memo_stats stats()
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			memo_stats result;
+
+			result.hits = nHits;
+			result.misses = nMisses;
+			result.size = slots.size();
+			result.capacity = nCapacity;
+
+			return result;
+		}
+
+	private:
+		void put(Key&& key, Value const& value, bool bAssign)
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			typename key_index::const_iterator itrCached = index.find(key);
+
+			if(itrCached != index.end())
+			{
+				if(bAssign)
+					slots[itrCached->second].value = value;
+
+				return;
+			}
+
+			if(slots.size() < nCapacity)
+			{
+				typename key_index::iterator itr = index.insert(typename key_index::value_type(std::move(key), slots.size())).first;
+				slots.push_back(slot(&itr->first, value));
+				return;
+			}
+
+			//the hand clears the reference bits until it finds the victim
+			while(slots[nHand].bReferenced)
+			{
+				slots[nHand].bReferenced = false;
+				nHand = (nHand + 1) % nCapacity;
+			}
+
+			slot& victim = slots[nHand];
+			index.erase(index.find(*victim.pKey));
+
+			typename key_index::iterator itr = index.insert(typename key_index::value_type(std::move(key), nHand)).first;
+			victim.pKey = &itr->first;
+			victim.value = value;
+			victim.bReferenced = false;
+
+			nHand = (nHand + 1) % nCapacity;
+		}
+
+		const size_t nCapacity;
+		std::mutex lock;
+		key_index index;
+		std::vector<slot> slots;
+		size_t nHand;
+		boost::uint64_t nHits;
+		boost::uint64_t nMisses;
+	};
+}
+
+#endif
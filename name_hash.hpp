@@ -0,0 +1,173 @@
+/**
+ * (C) Copyright 2013 Dreamer
+ *
+ * this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+* The constexpr FNV-1a hash of the function names. It is the default Hasher of the interpreter,
+* so DT_FUNCTION_ID("name") is the same ID as GetInvokerID("name") but a compile time constant.
+* An ASCII name has the same ID in the narrow and the wide characters.
+*
+* A function_table is a static registration table. Its IDs are computed at compile time, and
+* DT_FUNCTION_TABLE fails to compile if two of its names have the same ID.
+*/
+
+#ifndef _DT_NAME_HASH_
+#define _DT_NAME_HASH_
+
+#include <cstddef>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace DT
+{
+	namespace detail
+	{
+		template<size_t Bytes>
+		struct fnv1a_params;
+
+		template<>
+		struct fnv1a_params<4>
+		{
+			static constexpr size_t offset = 2166136261U;
+			static constexpr size_t prime = 16777619U;
+		};
+
+		template<>
+		struct fnv1a_params<8>
+		{
+			static constexpr size_t offset = (size_t)14695981039346656037ULL;
+			static constexpr size_t prime = (size_t)1099511628211ULL;
+		};
+
+		typedef fnv1a_params<sizeof(size_t)> fnv1a;
+
+		// an ASCII unit is one byte, so the wide name hashes as the narrow one
+		template<typename Char>
+		constexpr size_t fnv1a_unit(size_t hash, Char c)
+		{
+			typedef typename std::make_unsigned<Char>::type unit_type;
+			unit_type unit = (unit_type)c;
+
+			hash = (hash ^ (unsigned char)unit) * fnv1a::prime;
+
+			for(size_t nByte = 1; nByte < sizeof(Char) && unit >= 0x80; nByte++)
+				hash = (hash ^ (unsigned char)(unit >> (nByte * 8))) * fnv1a::prime;
+
+			return hash;
+		}
+	}
+
+	/** the FNV-1a hash of the names, the Hasher of the interpreter */
+	struct name_hash
+	{
+		template<typename Char>
+		constexpr size_t operator()(Char const* szName, size_t nLength) const
+		{
+			size_t hash = detail::fnv1a::offset;
+
+			for(size_t i = 0; i < nLength; i++)
+				hash = detail::fnv1a_unit(hash, szName[i]);
+
+			return hash;
+		}
+
+		template<typename Char, typename Traits, typename Alloc>
+		inline size_t operator()(std::basic_string<Char,Traits,Alloc> const& name) const
+		{
+			return (*this)(name.data(), name.size());
+		}
+	};
+
+	/** the ID of the name literal, e.g. function_id("add") */
+	template<typename Char, size_t N>
+	constexpr size_t function_id(Char const (&szName)[N])
+	{
+		return name_hash()(szName, N - 1);
+	}
+
+	/** a function of a function_table with its compile time ID */
+	template<typename Function>
+	struct function_entry
+	{
+		char const* name;
+		size_t id;
+		Function func;
+	};
+
+	template<typename Function, size_t N>
+	constexpr function_entry<Function> make_function_entry(char const (&szName)[N], Function func)
+	{
+		return function_entry<Function>{szName, function_id(szName), func};
+	}
+
+	/**
+	* The registration table of the functions, interpreter::register_table() registers them with
+	* the IDs computed here. The member functions of a table are registered with their object.
+	*/
+	template<typename... Functions>
+	struct function_table
+	{
+		std::tuple< function_entry<Functions>... > entries;
+
+		static constexpr size_t size = sizeof...(Functions);
+
+		/** no two entries have the same ID */
+		constexpr bool unique_ids() const
+		{
+			return unique_ids(std::index_sequence_for<Functions...>());
+		}
+
+	private:
+		template<size_t... Is>
+		constexpr bool unique_ids(std::index_sequence<Is...>) const
+		{
+			size_t ids[] = { 0, std::get<Is>(entries).id... };
+
+			for(size_t i = 1; i < sizeof(ids) / sizeof(ids[0]); i++)
+			{
+				for(size_t j = i + 1; j < sizeof(ids) / sizeof(ids[0]); j++)
+				{
+					if(ids[i] == ids[j])
+						return false;
+				}
+			}
+
+			return true;
+		}
+	};
+
+	template<typename... Functions>
+	constexpr function_table<Functions...> make_function_table(function_entry<Functions> const&... entries)
+	{
+		return function_table<Functions...>{ std::tuple< function_entry<Functions>... >(entries...) };
+	}
+}
+
+/** the function ID of the name literal as a compile time constant */
+#define DT_FUNCTION_ID(name)			(std::integral_constant<size_t, ::DT::function_id(name)>::value)
+
+#define DT_FUNCTION_ENTRY(name, func)	::DT::make_function_entry(name, func)
+
+/**
+* Define the static table of the functions at the namespace or the function scope, each argument
+* is a DT_FUNCTION_ENTRY. It is a compile error if two names have the same ID.
+*/
+#define DT_FUNCTION_TABLE(table, ...) \
+	static constexpr auto table = ::DT::make_function_table(__VA_ARGS__); \
+	static_assert(table.unique_ids(), "two names of the function table " #table " have the same ID")
+
+#endif
@@ -0,0 +1,163 @@
+/**
+ * (C) Copyright 2013 Dreamer
+ *
+ * this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+* The arena of a parse_input() call. While a parse_arena is in use on a thread, the arguments of
+* the std::pmr string types are converted into its monotonic buffer instead of the heap, and the
+* whole buffer is released at once when the outermost call using it returns. With the token
+* view parsers a call doesn't touch the heap at all once the buffer is big enough.
+*
+* An argument allocated in the arena must not outlive the call. A copy of it is allocated from
+* the default resource, but a moved one or a returned one still refers to the arena.
+*
+* It needs <memory_resource>, DT_PARSE_ARENA is defined if it is available.
+*/
+
+#ifndef _DT_PARSE_ARENA_
+#define _DT_PARSE_ARENA_
+
+#include <cstddef>
+#include <memory>
+
+#if __cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)
+#if defined(__has_include)
+#if __has_include(<memory_resource>)
+#include <memory_resource>
+#define DT_PARSE_ARENA
+#endif
+#endif
+#endif
+
+#ifdef DT_PARSE_ARENA
+
+namespace DT
+{
+	/** the default size of the initial buffer of a parse_arena in bytes */
+	const size_t parse_arena_size = 16 * 1024;
+
+	namespace detail
+	{
+		inline std::pmr::memory_resource*& parse_resource_slot()
+		{
+			static thread_local std::pmr::memory_resource* pResource = NULL;
+
+			return pResource;
+		}
+	}
+
+	/** the resource of the parse_arena in use on this thread, the default resource without one */
+	inline std::pmr::memory_resource* current_parse_resource()
+	{
+		std::pmr::memory_resource* pResource = detail::parse_resource_slot();
+
+		return pResource != NULL ? pResource : std::pmr::get_default_resource();
+	}
+
+	/** switch the resource of this thread for the scope, NULL is the default resource */
+	class parse_resource_scope
+	{
+	public:
+		explicit parse_resource_scope(std::pmr::memory_resource* pResource)
+			: pPrevious(detail::parse_resource_slot())
+		{
+			detail::parse_resource_slot() = pResource;
+		}
+
+		~parse_resource_scope()
+		{
+			detail::parse_resource_slot() = pPrevious;
+		}
+
+	private:
+		parse_resource_scope(parse_resource_scope const&);
+		parse_resource_scope& operator=(parse_resource_scope const&);
+
+		std::pmr::memory_resource* pPrevious;
+	};
+
+	/**
+	* A monotonic buffer released after every call using it. The buffer is owned or supplied by the
+	* caller, the upstream resource takes the overflow. It is used by one thread at a time.
+	*/
+	class parse_arena
+	{
+	public:
+		explicit parse_arena(size_t nBytes = parse_arena_size, std::pmr::memory_resource* pUpstream = std::pmr::get_default_resource())
+			: pOwned(new char[nBytes > 0 ? nBytes : 1]), nCapacity(nBytes > 0 ? nBytes : 1), resource(pOwned.get(), nCapacity, pUpstream), nDepth(0)
+		{ }
+
+		/** the caller's buffer, it must outlive the arena */
+		parse_arena(void* pBuffer, size_t nBytes, std::pmr::memory_resource* pUpstream = std::pmr::get_default_resource())
+			: nCapacity(nBytes), resource(pBuffer, nBytes, pUpstream), nDepth(0)
+		{ }
+
+		inline std::pmr::memory_resource* get()
+		{
+			return &resource;
+		}
+
+		/** the size of the initial buffer */
+		inline size_t capacity() const
+		{
+			return nCapacity;
+		}
+
+		inline bool in_use() const
+		{
+			return nDepth > 0;
+		}
+
+		/**
+		* Use the arena on this thread for the scope. The nested scopes share it, leaving the
+		* outermost one releases everything allocated in it.
+		*/
+		class scope
+		{
+		public:
+			explicit scope(parse_arena& arena)
+				: arena(arena), resource_scope(arena.get())
+			{
+				arena.nDepth++;
+			}
+
+			~scope()
+			{
+				if(--arena.nDepth == 0)
+					arena.resource.release();
+			}
+
+		private:
+			scope(scope const&);
+			scope& operator=(scope const&);
+
+			parse_arena& arena;
+			parse_resource_scope resource_scope;
+		};
+
+	private:
+		parse_arena(parse_arena const&);
+		parse_arena& operator=(parse_arena const&);
+
+		std::unique_ptr<char[]> pOwned;
+		size_t nCapacity;
+		std::pmr::monotonic_buffer_resource resource;
+		size_t nDepth;
+	};
+}
+
+#endif
+
+#endif
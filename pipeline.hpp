@@ -0,0 +1,250 @@
+/**
+ * (C) Copyright 2013 Dreamer
+ *
+ * this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+* The typed pipelines of the interpreter functions. A pipeline calls its stages in order and
+* moves the result of a stage into the first parameter of the next one, so a chained value is
+* never formatted and parsed again. The other parameters of the stages are the parameters of
+* the pipeline in the stage order, e.g. the pipeline of f(a, b) and g(x, c) takes (a, b, c).
+*
+* A stage is a function pointer or a member function bound by pipe_member(). The result of a
+* stage must be the same type as the first parameter of the next stage, it is checked when the
+* pipeline is registered.
+*/
+
+#ifndef _DT_PIPELINE_
+#define _DT_PIPELINE_
+
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "callable_traits.hpp"
+
+namespace DT
+{
+	/** a member function stage of a pipeline, the object must outlive the interpreter */
+	template<typename Function, typename TheClass>
+	struct member_stage
+	{
+		Function func;
+		TheClass* theclass;
+	};
+
+	template<typename Function, typename TheClass>
+	inline member_stage<Function, TheClass> pipe_member(Function f, TheClass* theclass)
+	{
+		static_assert(callable_traits<Function>::is_member, "pipe_member() takes a member function");
+
+		member_stage<Function, TheClass> stage = {f, theclass};
+		return stage;
+	}
+
+	namespace detail
+	{
+		template<typename... Lists>
+		struct concat_types;
+
+		template<typename... Types>
+		struct concat_types< type_list<Types...> >
+		{
+			typedef type_list<Types...> type;
+		};
+
+		template<typename... Types1, typename... Types2, typename... Lists>
+		struct concat_types< type_list<Types1...>, type_list<Types2...>, Lists... > : concat_types< type_list<Types1..., Types2...>, Lists... >
+		{ };
+
+		// the piped parameter and the rest, a stage without parameters can't take the piped value
+		struct no_piped_param;
+
+		template<typename List>
+		struct split_piped
+		{
+			typedef no_piped_param head;
+			typedef type_list<> tail;
+		};
+
+		template<typename Head, typename... Tail>
+		struct split_piped< type_list<Head, Tail...> >
+		{
+			typedef Head head;
+			typedef type_list<Tail...> tail;
+		};
+
+		// the function and the object of a stage
+		template<typename Stage>
+		struct stage_traits : callable_traits<Stage>
+		{
+			static_assert(callable_traits<Stage>::is_function && !callable_traits<Stage>::is_member, "a pipeline stage is a function pointer or a pipe_member()");
+
+			static inline Stage function(Stage const& stage) { return stage; }
+			static inline void* object(Stage const&) { return NULL; }
+		};
+
+		template<typename Function, typename TheClass>
+		struct stage_traits< member_stage<Function, TheClass> > : callable_traits<Function>
+		{
+			static inline Function function(member_stage<Function, TheClass> const& stage) { return stage.func; }
+			static inline TheClass* object(member_stage<Function, TheClass> const& stage) { return stage.theclass; }
+		};
+
+		// the parameters of a stage read by the pipeline, the first stage reads all of them
+		template<typename Stage, bool bFirst>
+		struct stage_params
+		{
+			typedef typename split_piped<typename stage_traits<Stage>::arg_types>::tail type;
+		};
+
+		template<typename Stage>
+		struct stage_params<Stage, true>
+		{
+			typedef typename stage_traits<Stage>::arg_types type;
+		};
+
+		// the result of From is moved or referred as the piped parameter of To
+		template<typename From, typename To>
+		struct is_piped
+		{
+			typedef typename stage_traits<From>::result_type result_type;
+			typedef typename split_piped<typename stage_traits<To>::arg_types>::head param_type;
+
+			static const bool value = !std::is_void<result_type>::value
+				&& std::is_same<typename std::decay<result_type>::type, typename std::decay<param_type>::type>::value;
+		};
+
+		template<typename... Stages>
+		struct all_piped : std::true_type
+		{ };
+
+		template<typename From, typename To, typename... Stages>
+		struct all_piped<From, To, Stages...> : std::integral_constant<bool, is_piped<From, To>::value && all_piped<To, Stages...>::value>
+		{ };
+
+		template<size_t... Is, typename... Stages>
+		inline typename concat_types<typename stage_params<Stages, Is == 0>::type...>::type pipeline_params(std::index_sequence<Is...>, type_list<Stages...>);
+	}
+
+	/** the stages of a pipeline, the interpreter registers it by a pipeline_ref */
+	template<typename... Stages>
+	class pipeline_function
+	{
+		typedef std::tuple<Stages...> stage_tuple;
+		static const size_t stage_count = sizeof...(Stages);
+
+		template<size_t nStage>
+		struct stage
+		{
+			typedef typename std::tuple_element<nStage, stage_tuple>::type type;
+			typedef detail::stage_traits<type> traits;
+			typedef typename detail::stage_params<type, nStage == 0>::type params;
+		};
+
+	public:
+		static_assert(sizeof...(Stages) >= 2, "a pipeline has two stages at least");
+		static_assert(detail::all_piped<Stages...>::value, "the result of a pipeline stage isn't the type of the first parameter of the next stage");
+
+		typedef typename stage<sizeof...(Stages) - 1>::traits::result_type result_type;
+		typedef decltype(detail::pipeline_params(std::index_sequence_for<Stages...>(), type_list<Stages...>())) arg_types;
+
+		explicit pipeline_function(Stages... stages) : stages(stages...)
+		{ }
+
+		template<typename... Args>
+		inline result_type operator()(Args&&... args) const
+		{
+			std::tuple<Args&&...> params(std::forward<Args>(args)...);
+
+			return next<1, stage<0>::params::size>(params, call_first(params, std::make_index_sequence<stage<0>::params::size>()));
+		}
+
+	private:
+		template<typename Params, size_t... Is>
+		inline typename stage<0>::traits::result_type call_first(Params& params, std::index_sequence<Is...>) const
+		{
+			typedef typename stage<0>::traits traits;
+
+			return detail::callable_invoke(traits::function(std::get<0>(stages)), traits::object(std::get<0>(stages)),
+				std::forward<typename std::tuple_element<Is, Params>::type>(std::get<Is>(params))...);
+		}
+
+		template<size_t nStage, size_t nOffset, typename Params, typename Value>
+		inline result_type next(Params& params, Value&& value) const
+		{
+			return next<nStage, nOffset>(params, std::forward<Value>(value), std::integral_constant<bool, nStage + 1 == stage_count>());
+		}
+
+		// the last stage returns the result of the pipeline
+		template<size_t nStage, size_t nOffset, typename Params, typename Value>
+		inline result_type next(Params& params, Value&& value, std::true_type) const
+		{
+			return call_piped<nStage, nOffset, Params, Value>(params, value, std::make_index_sequence<stage<nStage>::params::size>());
+		}
+
+		template<size_t nStage, size_t nOffset, typename Params, typename Value>
+		inline result_type next(Params& params, Value&& value, std::false_type) const
+		{
+			return next<nStage + 1, nOffset + stage<nStage>::params::size>(params,
+				call_piped<nStage, nOffset, Params, Value>(params, value, std::make_index_sequence<stage<nStage>::params::size>()));
+		}
+
+		// the value is the result of the previous stage, it lives until the pipeline returns. A
+		// returned object is moved on, a returned reference is passed on as it is
+		template<size_t nStage, size_t nOffset, typename Params, typename Value, size_t... Is>
+		inline typename stage<nStage>::traits::result_type call_piped(Params& params, Value& value, std::index_sequence<Is...>) const
+		{
+			typedef typename stage<nStage>::traits traits;
+			typedef typename detail::split_piped<typename traits::arg_types>::head piped_param;
+
+			return detail::callable_invoke(traits::function(std::get<nStage>(stages)), traits::object(std::get<nStage>(stages)),
+				detail::pass_arg<piped_param, Value>(value),
+				std::forward<typename std::tuple_element<nOffset + Is, Params>::type>(std::get<nOffset + Is>(params))...);
+		}
+
+		stage_tuple stages;
+	};
+
+	/** the handle of a pipeline_function, it is registered like a function pointer */
+	template<typename... Stages>
+	struct pipeline_ref
+	{
+		pipeline_function<Stages...> const* pPipeline;
+
+		template<typename... Args>
+		inline typename pipeline_function<Stages...>::result_type operator()(Args&&... args) const
+		{
+			return (*pPipeline)(std::forward<Args>(args)...);
+		}
+	};
+
+	namespace detail
+	{
+		template<typename R, typename List>
+		struct pipeline_signature;
+
+		template<typename R, typename... Args>
+		struct pipeline_signature< R, type_list<Args...> > : callable_signature<R, void, Args...>
+		{ };
+	}
+
+	template<typename... Stages>
+	struct callable_traits< pipeline_ref<Stages...> >
+		: detail::pipeline_signature<typename pipeline_function<Stages...>::result_type, typename pipeline_function<Stages...>::arg_types>
+	{ };
+}
+
+#endif
@@ -0,0 +1,214 @@
+/**
+ * (C) Copyright 2013 Dreamer
+ *
+ * this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+* The epoch based reclamation of the objects read without a lock, e.g. the registry snapshots
+* of the interpreter. A thread announces the global epoch while it is in a reader scope, and
+* the epoch advances only when every thread in a scope has announced it. An object which is
+* unreachable when it is retired at epoch N can't be seen by any reader once the epoch is N + 2.
+*
+* On Linux the reader announces by a plain store and the rare advance pays for the ordering with
+* membarrier(), so a scope costs the readers no fence. Elsewhere the announcement is a full fence.
+*/
+
+#ifndef _DT_READER_EPOCH_
+#define _DT_READER_EPOCH_
+
+#include <atomic>
+#include <cstddef>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/membarrier.h>)
+#include <linux/membarrier.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define DT_READER_MEMBARRIER
+#endif
+#endif
+
+namespace DT
+{
+	class reader_epoch
+	{
+		// the announcement of a thread, the records are reused but never freed
+		struct record
+		{
+			/** (epoch << 1) | 1 in a scope, 0 out of it */
+			std::atomic<size_t> state;
+			std::atomic<bool> used;
+			size_t nesting;
+			record* pNext;
+
+			// keep the announcements of the threads on their own cache lines
+			char padding[64 - 3 * sizeof(size_t) - sizeof(void*)];
+
+			record() : state(0), used(true), nesting(0), pNext(NULL) { }
+		};
+
+		// returns the record to the pool when the thread exits
+		struct record_owner
+		{
+			record* pRecord;
+
+			record_owner() : pRecord(NULL) { }
+
+			~record_owner()
+			{
+				if(pRecord != NULL)
+					pRecord->used.store(false, std::memory_order_release);
+			}
+		};
+
+	public:
+		/** the reader scope, it pins every object which isn't retired yet. The scopes nest */
+		class scope
+		{
+		public:
+			scope() : pRecord(thread_record())
+			{
+				//the store is ordered before the reads of the scope, by try_advance() if it is asymmetric
+				if(pRecord->nesting++ == 0)
+				{
+					size_t nState = (global_epoch().load(std::memory_order_relaxed) << 1) | 1;
+
+					if(asymmetric())
+					{
+						pRecord->state.store(nState, std::memory_order_relaxed);
+						std::atomic_signal_fence(std::memory_order_seq_cst);
+					}
+					else
+						pRecord->state.store(nState);
+				}
+			}
+
+			~scope()
+			{
+				if(--pRecord->nesting == 0)
+					pRecord->state.store(0, std::memory_order_release);
+			}
+
+		private:
+			scope(scope const&);
+			scope& operator=(scope const&);
+
+			record* pRecord;
+		};
+
+		/** the epoch to tag a retired object with, it is retired after it is made unreachable */
+		static inline size_t current()
+		{
+			return global_epoch().load();
+		}
+
+		/**
+		* Advance the epoch if every thread in a scope has announced it. It never waits.
+		*
+		* \return the epoch after the attempt
+		*/
+		static size_t try_advance()
+		{
+			reader_fence();
+
+			size_t nEpoch = global_epoch().load();
+			size_t nAnnounced = (nEpoch << 1) | 1;
+
+			for(record* pRecord = records().load(); pRecord != NULL; pRecord = pRecord->pNext)
+			{
+				size_t nState = pRecord->state.load();
+
+				if(nState != 0 && nState != nAnnounced)
+					return nEpoch;
+			}
+
+			global_epoch().compare_exchange_strong(nEpoch, nEpoch + 1);
+
+			return global_epoch().load();
+		}
+
+	private:
+		/** the readers don't fence, the writer makes every running thread fence for them */
+		static inline bool asymmetric()
+		{
+#ifdef DT_READER_MEMBARRIER
+			static const bool bRegistered = ::syscall(__NR_membarrier, MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED, 0, 0) == 0;
+			return bRegistered;
+#else
+			return false;
+#endif
+		}
+
+		// order the announcements of the readers before the loads of the writer
+		static inline void reader_fence()
+		{
+#ifdef DT_READER_MEMBARRIER
+			if(asymmetric() && ::syscall(__NR_membarrier, MEMBARRIER_CMD_PRIVATE_EXPEDITED, 0, 0) == 0)
+				return;
+#endif
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+		}
+
+		static inline std::atomic<size_t>& global_epoch()
+		{
+			static std::atomic<size_t> nEpoch(0);
+			return nEpoch;
+		}
+
+		static inline std::atomic<record*>& records()
+		{
+			static std::atomic<record*> pHead(NULL);
+			return pHead;
+		}
+
+		static inline record* thread_record()
+		{
+			static thread_local record* pRecord = NULL;
+
+			if(pRecord == NULL)
+				pRecord = acquire_record();
+
+			return pRecord;
+		}
+
+		static record* acquire_record()
+		{
+			static thread_local record_owner owner;
+			record* pRecord = NULL;
+
+			for(record* pFree = records().load(); pFree != NULL && pRecord == NULL; pFree = pFree->pNext)
+			{
+				bool bUsed = false;
+
+				if(!pFree->used.load(std::memory_order_relaxed) && pFree->used.compare_exchange_strong(bUsed, true))
+					pRecord = pFree;
+			}
+
+			if(pRecord == NULL)
+			{
+				pRecord = new record();
+				pRecord->pNext = records().load();
+
+				while(!records().compare_exchange_weak(pRecord->pNext, pRecord))
+					;
+			}
+
+			owner.pRecord = pRecord;
+
+			return pRecord;
+		}
+	};
+}
+
+#endif
@@ -0,0 +1,416 @@
+/**
+ * (C) Copyright 2013 Dreamer
+ *
+ * this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+* The shared memory transport of the interpreter RPC (see shm_rpc.hpp). A shm_channel is a POSIX
+* shared memory object holding two single-producer single-consumer rings, one for the requests
+* and one for the responses. A message is written in place into the ring and read in place from
+* it, it is never copied through a pipe or a socket.
+*
+* A reader spins a while and then sleeps on a futex in the shared memory. A writer publishes any
+* number of messages and wakes the reader once by notify(), and only if it is sleeping, so a
+* busy reader takes a batch without a system call. A writer waiting for the space of a full ring
+* yields instead of sleeping. Linux only.
+*/
+
+#ifndef _DT_SHM_RING_
+#define _DT_SHM_RING_
+
+#include <cstddef>
+#include <cstring>
+#include <atomic>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include <boost/cstdint.hpp>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <climits>
+#endif
+
+#ifdef __linux__
+
+namespace DT
+{
+	/** the default capacity of a ring of shm_channel in bytes */
+	const size_t shm_ring_capacity = 1024 * 1024;
+
+	namespace detail
+	{
+		// the futex word is in the shared memory, so it isn't FUTEX_PRIVATE
+		inline void futex_wait(std::atomic<boost::uint32_t>* pWord, boost::uint32_t nExpected)
+		{
+			::syscall(SYS_futex, reinterpret_cast<boost::uint32_t*>(pWord), FUTEX_WAIT, nExpected, NULL, NULL, 0);
+		}
+
+		inline void futex_wake(std::atomic<boost::uint32_t>* pWord)
+		{
+			::syscall(SYS_futex, reinterpret_cast<boost::uint32_t*>(pWord), FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+		}
+
+		static_assert(sizeof(std::atomic<boost::uint32_t>) == sizeof(boost::uint32_t) && std::atomic<boost::uint64_t>::is_always_lock_free,
+			"the shared ring needs the lock-free atomics of the plain size");
+
+		/**
+		* The control block of a ring in the shared memory. head and tail count the bytes written
+		* and read since the start, the writer and the reader own one of them each.
+		*/
+		struct shm_ring_header
+		{
+			alignas(64) std::atomic<boost::uint64_t> head;
+			alignas(64) std::atomic<boost::uint64_t> tail;
+
+			/** bumped by notify(), the reader sleeps on it */
+			alignas(64) std::atomic<boost::uint32_t> wakeups;
+			std::atomic<boost::uint32_t> sleeping;
+		};
+	}
+
+	/**
+	* A single-producer single-consumer ring of messages. A message is a frame of an 8 byte header
+	* and the payload padded to 8 bytes. A message never wraps around the end of the ring, the rest
+	* of the ring is skipped instead, so its payload is contiguous.
+	*/
+	class shm_ring
+	{
+		static const boost::uint32_t frame_header = 8;
+		static const boost::uint32_t skip_frame = 0xFFFFFFFF;
+
+	public:
+		shm_ring() : pHeader(NULL), pData(NULL), nCapacity(0), nReserved(0)
+		{ }
+
+		shm_ring(detail::shm_ring_header* pHeader, char* pData, size_t nCapacity)
+			: pHeader(pHeader), pData(pData), nCapacity(nCapacity), nReserved(0)
+		{ }
+
+		/** the largest payload of a message */
+		inline size_t max_message() const
+		{
+			return nCapacity / 2 - frame_header;
+		}
+
+		/**
+		* Reserve the contiguous space of the next message, it waits while the ring is full. The
+		* message is invisible to the reader until commit().
+		*
+		* \throw std::runtime_error if the message is bigger than max_message()
+		*/
+		char* reserve(size_t nSize)
+		{
+			char* p = NULL;
+
+			while((p = try_reserve(nSize)) == NULL)
+				std::this_thread::yield();
+
+			return p;
+		}
+
+		/**
+		* reserve() without waiting, a writer which also reads the other ring of the channel frees
+		* its space meanwhile.
+		*
+		* \return NULL if the ring is full
+		* \throw std::runtime_error if the message is bigger than max_message()
+		*/
+		char* try_reserve(size_t nSize)
+		{
+			if(nSize > max_message())
+				throw std::runtime_error("the message is too big for the shared memory ring");
+
+			boost::uint64_t nHead = pHeader->head.load(std::memory_order_relaxed);
+			size_t nPos = (size_t)(nHead % nCapacity);
+			size_t nFrame = frame_size(nSize);
+			size_t nSkip = nCapacity - nPos < nFrame ? nCapacity - nPos : 0;
+
+			// the reader frees the space, it may sleep on the messages not notified yet
+			if(nCapacity - (size_t)(nHead - pHeader->tail.load(std::memory_order_acquire)) < nSkip + nFrame)
+			{
+				notify();
+				return NULL;
+			}
+
+			if(nSkip > 0)
+			{
+				store_size(nPos, skip_frame);
+				nHead += nSkip;
+				pHeader->head.store(nHead, std::memory_order_release);
+				nPos = 0;
+			}
+
+			nReserved = nSize;
+			return pData + nPos + frame_header;
+		}
+
+		/** publish the reserved message, the reader isn't woken up until notify() */
+		inline void commit()
+		{
+			boost::uint64_t nHead = pHeader->head.load(std::memory_order_relaxed);
+
+			store_size((size_t)(nHead % nCapacity), (boost::uint32_t)nReserved);
+			pHeader->head.store(nHead + frame_size(nReserved), std::memory_order_release);
+		}
+
+		/** wake the reader up if it sleeps */
+		inline void notify()
+		{
+			pHeader->wakeups.fetch_add(1, std::memory_order_seq_cst);
+
+			if(pHeader->sleeping.load(std::memory_order_seq_cst) != 0)
+				detail::futex_wake(&pHeader->wakeups);
+		}
+
+		/**
+		* The next message without waiting.
+		*
+		* \return NULL if the ring is empty
+		*/
+		char const* peek(size_t& nSize)
+		{
+			for(;;)
+			{
+				boost::uint64_t nTail = pHeader->tail.load(std::memory_order_relaxed);
+
+				if(pHeader->head.load(std::memory_order_acquire) == nTail)
+					return NULL;
+
+				size_t nPos = (size_t)(nTail % nCapacity);
+				boost::uint32_t nFrameSize = load_size(nPos);
+
+				if(nFrameSize == skip_frame)
+				{
+					pHeader->tail.store(nTail + (nCapacity - nPos), std::memory_order_release);
+					continue;
+				}
+
+				nSize = nFrameSize;
+				return pData + nPos + frame_header;
+			}
+		}
+
+		/** release the message of peek(), its space is reused */
+		inline void pop(size_t nSize)
+		{
+			pHeader->tail.store(pHeader->tail.load(std::memory_order_relaxed) + frame_size(nSize), std::memory_order_release);
+		}
+
+		/**
+		* Wait for the next message, it spins nSpins times before it sleeps on the futex. By default
+		* it spins on a multiprocessor only, a single CPU runs the writer only after the reader sleeps.
+		*
+		* \return NULL if bStop is set, the stopping thread calls notify() to wake the reader
+		*/
+		char const* wait(size_t& nSize, std::atomic<bool> const& bStop)
+		{
+			static const size_t nDefaultSpins = std::thread::hardware_concurrency() > 1 ? 4096 : 0;
+
+			return wait(nSize, bStop, nDefaultSpins);
+		}
+
+		char const* wait(size_t& nSize, std::atomic<bool> const& bStop, size_t nSpins)
+		{
+			for(;;)
+			{
+				for(size_t i = 0; i <= nSpins; i++)
+				{
+					char const* pMessage = peek(nSize);
+
+					if(pMessage != NULL)
+						return pMessage;
+
+					if(bStop.load(std::memory_order_relaxed))
+						return NULL;
+				}
+
+				boost::uint32_t nWakeups = pHeader->wakeups.load(std::memory_order_seq_cst);
+				pHeader->sleeping.store(1, std::memory_order_seq_cst);
+
+				//the writer may have published before it saw the sleeping flag
+				if(pHeader->head.load(std::memory_order_seq_cst) == pHeader->tail.load(std::memory_order_relaxed) && !bStop.load())
+					detail::futex_wait(&pHeader->wakeups, nWakeups);
+
+				pHeader->sleeping.store(0, std::memory_order_relaxed);
+			}
+		}
+
+	private:
+		static inline size_t frame_size(size_t nSize)
+		{
+			return frame_header + ((nSize + 7) & ~(size_t)7);
+		}
+
+		inline void store_size(size_t nPos, boost::uint32_t nSize)
+		{
+			std::memcpy(pData + nPos, &nSize, sizeof(nSize));
+		}
+
+		inline boost::uint32_t load_size(size_t nPos) const
+		{
+			boost::uint32_t nSize;
+			std::memcpy(&nSize, pData + nPos, sizeof(nSize));
+			return nSize;
+		}
+
+		detail::shm_ring_header* pHeader;
+		char* pData;
+		size_t nCapacity;
+		size_t nReserved;
+	};
+
+	/**
+	* The shared memory of a host and one client, the host creates it and the client opens it by
+	* the name. The requests go from the client to the host, the responses back.
+	*/
+	class shm_channel
+	{
+		static const boost::uint64_t channel_magic = 0x4454525043484e31ULL;
+
+		struct channel_header
+		{
+			boost::uint64_t magic;
+			boost::uint64_t capacity;
+			detail::shm_ring_header requests;
+			detail::shm_ring_header responses;
+		};
+
+	public:
+		/**
+		* Create the channel of the name, e.g. "/my_host". An old one of the name is replaced. The
+		* creator unlinks the name when it is destroyed.
+		*
+		* \throw std::runtime_error if the shared memory can't be created
+		*/
+		static shm_channel* create(std::string const& strName, size_t nCapacity = shm_ring_capacity)
+		{
+			nCapacity = (nCapacity + 4095) & ~(size_t)4095;
+
+			int fd = ::shm_open(strName.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0600);
+			if(fd < 0)
+				throw std::runtime_error("can't create the shared memory " + strName);
+
+			size_t nSize = sizeof(channel_header) + 2 * nCapacity;
+
+			if(::ftruncate(fd, (off_t)nSize) != 0)
+			{
+				::close(fd);
+				::shm_unlink(strName.c_str());
+				throw std::runtime_error("can't size the shared memory " + strName);
+			}
+
+			shm_channel* pChannel = new shm_channel(strName, fd, nSize, true);
+			channel_header* pHeader = pChannel->header();
+
+			//the new object is zero filled, so the atomics start at 0
+			pHeader->capacity = nCapacity;
+			std::atomic_thread_fence(std::memory_order_release);
+			pHeader->magic = channel_magic;
+
+			pChannel->init_rings();
+			return pChannel;
+		}
+
+		/** \throw std::runtime_error if the channel doesn't exist */
+		static shm_channel* open(std::string const& strName)
+		{
+			int fd = ::shm_open(strName.c_str(), O_RDWR, 0600);
+			struct stat status;
+
+			if(fd < 0)
+				throw std::runtime_error("can't open the shared memory " + strName);
+
+			if(::fstat(fd, &status) != 0 || (size_t)status.st_size < sizeof(channel_header))
+			{
+				::close(fd);
+				throw std::runtime_error("the shared memory " + strName + " isn't a channel");
+			}
+
+			shm_channel* pChannel = new shm_channel(strName, fd, (size_t)status.st_size, false);
+
+			if(pChannel->header()->magic != channel_magic || sizeof(channel_header) + 2 * pChannel->header()->capacity != (size_t)status.st_size)
+			{
+				delete pChannel;
+				throw std::runtime_error("the shared memory " + strName + " isn't a channel");
+			}
+
+			pChannel->init_rings();
+			return pChannel;
+		}
+
+		~shm_channel()
+		{
+			::munmap(pMemory, nSize);
+
+			if(bOwner)
+				::shm_unlink(strName.c_str());
+		}
+
+		inline shm_ring& requests() { return request_ring; }
+		inline shm_ring& responses() { return response_ring; }
+
+	private:
+		shm_channel(std::string const& strName, int fd, size_t nSize, bool bOwner)
+			: strName(strName), pMemory(NULL), nSize(nSize), bOwner(bOwner)
+		{
+			void* pMapped = ::mmap(NULL, nSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+			::close(fd);
+
+			if(pMapped == MAP_FAILED)
+			{
+				if(bOwner)
+					::shm_unlink(strName.c_str());
+
+				throw std::runtime_error("can't map the shared memory " + strName);
+			}
+
+			pMemory = pMapped;
+		}
+
+		inline channel_header* header()
+		{
+			return static_cast<channel_header*>(pMemory);
+		}
+
+		void init_rings()
+		{
+			char* pData = static_cast<char*>(pMemory) + sizeof(channel_header);
+			size_t nCapacity = (size_t)header()->capacity;
+
+			request_ring = shm_ring(&header()->requests, pData, nCapacity);
+			response_ring = shm_ring(&header()->responses, pData + nCapacity, nCapacity);
+		}
+
+		shm_channel(shm_channel const&);
+		shm_channel& operator=(shm_channel const&);
+
+		std::string strName;
+		void* pMemory;
+		size_t nSize;
+		bool bOwner;
+		shm_ring request_ring;
+		shm_ring response_ring;
+	};
+}
+
+#endif
+
+#endif
@@ -0,0 +1,555 @@
+/**
+ * (C) Copyright 2013 Dreamer
+ *
+ * this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+* The RPC front end of an interpreter for the other processes of the host. An rpc_client writes
+* the function ID and the binary arguments into the shared memory of a shm_channel, the
+* rpc_server of the host reads them in place by rpc_param_parser, calls the typed
+* TryExecInvoker() and writes the binary result back. Nothing is formatted as text.
+*
+* The host registers the functions in an interpreter<rpc_param_parser> and exposes them to the
+* server with their result types. The values are in the native layout of the host, a client
+* runs on the same machine with the same ABI. rpc_codec converts the arithmetic and the other
+* trivially copyable types, the strings and std::string_view; specialize it for the others. A
+* view is only an argument, the result of a function returning one is received as a string.
+*
+* Batching: post() any number of calls, flush() them with one wakeup, then receive() the results
+* in the same order. The server takes all the pending calls before it wakes the client up. While
+* the request ring is full, post() takes the responses out of the response ring, so any number
+* of calls can be posted before receive().
+*/
+
+#ifndef _DT_SHM_RPC_
+#define _DT_SHM_RPC_
+
+#include <cstddef>
+#include <cstring>
+#include <atomic>
+#include <deque>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <typeinfo>
+#include <unordered_map>
+
+#include <boost/cstdint.hpp>
+
+#include "Interpreter.hpp"
+#include "shm_ring.hpp"
+#include "token_cast.hpp"
+
+namespace DT
+{
+	/**
+	* The binary form of an argument or a result. size() is the encoded size of the value, write()
+	* returns the end of the written value and read() returns false for a truncated value.
+	*/
+	template<typename T, typename Enable = void>
+	struct rpc_codec
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "specialize DT::rpc_codec for the type");
+
+		static inline size_t size(T const&)
+		{
+			return sizeof(T);
+		}
+
+		static inline char* write(char* p, T const& value)
+		{
+			std::memcpy(p, &value, sizeof(T));
+			return p + sizeof(T);
+		}
+
+		static inline bool read(char const*& p, char const* pEnd, T& value)
+		{
+			if((size_t)(pEnd - p) < sizeof(T))
+				return false;
+
+			std::memcpy(&value, p, sizeof(T));
+			p += sizeof(T);
+			return true;
+		}
+	};
+
+	/** a string is its length and its characters */
+	template<typename Char, typename Traits, typename Alloc>
+	struct rpc_codec< std::basic_string<Char,Traits,Alloc> >
+	{
+		static inline size_t size(std::basic_string<Char,Traits,Alloc> const& value)
+		{
+			return sizeof(boost::uint32_t) + value.size() * sizeof(Char);
+		}
+
+		static inline char* write(char* p, std::basic_string<Char,Traits,Alloc> const& value)
+		{
+			p = rpc_codec<boost::uint32_t>::write(p, (boost::uint32_t)value.size());
+			std::memcpy(p, value.data(), value.size() * sizeof(Char));
+			return p + value.size() * sizeof(Char);
+		}
+
+		static inline bool read(char const*& p, char const* pEnd, std::basic_string<Char,Traits,Alloc>& value)
+		{
+			boost::uint32_t nLength = 0;
+			char const* pAt = p;
+
+			if(!rpc_codec<boost::uint32_t>::read(pAt, pEnd, nLength) || (size_t)(pEnd - pAt) / sizeof(Char) < nLength)
+				return false;
+
+			value.resize(nLength);
+			std::memcpy(&value[0], pAt, nLength * sizeof(Char));
+			p = pAt + nLength * sizeof(Char);
+			return true;
+		}
+	};
+
+#ifdef __cpp_lib_string_view
+	/** the same form as std::string, the read view refers into the shared memory during the call */
+	template<typename Traits>
+	struct rpc_codec< std::basic_string_view<char,Traits> >
+	{
+		static inline size_t size(std::basic_string_view<char,Traits> const& value)
+		{
+			return sizeof(boost::uint32_t) + value.size();
+		}
+
+		static inline char* write(char* p, std::basic_string_view<char,Traits> const& value)
+		{
+			p = rpc_codec<boost::uint32_t>::write(p, (boost::uint32_t)value.size());
+			std::memcpy(p, value.data(), value.size());
+			return p + value.size();
+		}
+
+		static inline bool read(char const*& p, char const* pEnd, std::basic_string_view<char,Traits>& value)
+		{
+			boost::uint32_t nLength = 0;
+			char const* pAt = p;
+
+			if(!rpc_codec<boost::uint32_t>::read(pAt, pEnd, nLength) || (size_t)(pEnd - pAt) < nLength)
+				return false;
+
+			value = std::basic_string_view<char,Traits>(pAt, nLength);
+			p = pAt + nLength;
+			return true;
+		}
+	};
+#endif
+
+	/** the parser of the binary arguments of a call, see rpc_codec */
+	class rpc_param_parser
+	{
+	public:
+		rpc_param_parser(char const* pBegin, char const* pEnd)
+			: pAt(pBegin), pEnd(pEnd)
+		{ }
+
+		/** \throw std::runtime_error if the argument is truncated */
+		template<typename RequestedType>
+		typename std::decay<RequestedType>::type get()
+		{
+			bool bOk = false;
+			typename std::decay<RequestedType>::type value = try_get<RequestedType>(bOk);
+
+			if(!bOk)
+				throw std::runtime_error("invalid argument: truncated " + std::string(typeid(value).name()));
+
+			return value;
+		}
+
+		/** the missing argument is the default value, like interpreter_param_parser */
+		template<typename RequestedType>
+		typename std::decay<RequestedType>::type try_get(bool & bOk)
+		{
+			typedef typename std::decay<RequestedType>::type value_type;
+			value_type value = detail::token_value<value_type>::make();
+
+			bOk = true;
+
+			if(has_more_tokens())
+				bOk = rpc_codec<value_type>::read(pAt, pEnd, value);
+
+			return value;
+		}
+
+		inline bool has_more_tokens() const
+		{
+			return pAt != pEnd;
+		}
+
+	private:
+		char const* pAt;
+		char const* pEnd;
+	};
+
+#ifdef __linux__
+
+	/** the status of a response, the invoker_errc values or a failed call */
+	const boost::uint32_t rpc_exception = 0x100;
+
+	namespace detail
+	{
+		// a request is the function ID and the arguments, a response the function ID, the status,
+		// the argument index and the result or the exception message
+		const size_t rpc_request_header = sizeof(boost::uint64_t);
+		const size_t rpc_response_header = sizeof(boost::uint64_t) + 2 * sizeof(boost::uint32_t);
+
+		// a received view would refer into the popped response
+		template<typename T>
+		struct rpc_is_view : std::false_type { };
+
+#ifdef __cpp_lib_string_view
+		template<typename Char, typename Traits>
+		struct rpc_is_view< std::basic_string_view<Char,Traits> > : std::true_type { };
+#endif
+
+		inline size_t rpc_args_size()
+		{
+			return 0;
+		}
+
+		template<typename Arg, typename... Args>
+		inline size_t rpc_args_size(Arg const& arg, Args const&... args)
+		{
+			return rpc_codec<Arg>::size(arg) + rpc_args_size(args...);
+		}
+
+		inline char* rpc_write_args(char* p)
+		{
+			return p;
+		}
+
+		template<typename Arg, typename... Args>
+		inline char* rpc_write_args(char* p, Arg const& arg, Args const&... args)
+		{
+			return rpc_write_args(rpc_codec<Arg>::write(p, arg), args...);
+		}
+
+		inline char* rpc_write_response(char* p, size_t fnID, boost::uint32_t nStatus, size_t nArgIndex)
+		{
+			p = rpc_codec<boost::uint64_t>::write(p, (boost::uint64_t)fnID);
+			p = rpc_codec<boost::uint32_t>::write(p, nStatus);
+			return rpc_codec<boost::uint32_t>::write(p, (boost::uint32_t)nArgIndex);
+		}
+	}
+
+	/**
+	* Serve the calls of one shm_channel by the interpreter, run() serves them on the calling
+	* thread until stop(). A host serves several clients by a server and a thread per channel.
+	*/
+	template<typename Interpreter>
+	class rpc_server
+	{
+		typedef void (*call_function)(Interpreter&, size_t, rpc_param_parser&, shm_ring&);
+
+	public:
+		rpc_server(Interpreter& interp, shm_channel& channel)
+			: interp(interp), channel(channel), bStop(false)
+		{ }
+
+		/**
+		* Expose the registered function, R is its return type or the value type of its future.
+		*
+		* \return false if the function isn't registered
+		*/
+		template<typename R>
+		bool expose(size_t fnID)
+		{
+			if(interp.GetInvokerName(fnID).empty())
+				return false;
+
+			calls[fnID] = &call_typed<R>;
+			return true;
+		}
+
+		/** register the function into the interpreter and expose it */
+		template<typename Function>
+		size_t register_function(std::string const & name, Function f)
+		{
+			size_t fnID = interp.register_function(name, f);
+
+			expose<typename detail::result_value<typename callable_traits<Function>::result_type>::type>(fnID);
+			return fnID;
+		}
+
+		/** serve the calls until stop(), a batch of calls is answered by one wakeup */
+		void run()
+		{
+			shm_ring& requests = channel.requests();
+			size_t nSize = 0;
+			char const* pMessage = NULL;
+
+			while((pMessage = requests.wait(nSize, bStop)) != NULL)
+			{
+				do
+				{
+					serve(pMessage, nSize);
+					requests.pop(nSize);
+				}
+				while((pMessage = requests.peek(nSize)) != NULL);
+
+				channel.responses().notify();
+			}
+		}
+
+		void stop()
+		{
+			bStop.store(true);
+			channel.requests().notify();
+		}
+
+	private:
+		void serve(char const* pMessage, size_t nSize)
+		{
+			boost::uint64_t fnID = 0;
+			char const* pArgs = pMessage;
+			shm_ring& responses = channel.responses();
+
+			//the client receives a response for every request, even a truncated one
+			if(!rpc_codec<boost::uint64_t>::read(pArgs, pMessage + nSize, fnID))
+			{
+				detail::rpc_write_response(responses.reserve(detail::rpc_response_header), 0, invoker_invalid_argument, 0);
+				responses.commit();
+				return;
+			}
+
+			typename std::unordered_map<size_t, call_function>::const_iterator itr = calls.find((size_t)fnID);
+
+			if(itr == calls.end())
+			{
+				detail::rpc_write_response(responses.reserve(detail::rpc_response_header), (size_t)fnID, invoker_unknown_function, 0);
+				responses.commit();
+				return;
+			}
+
+			rpc_param_parser parser(pArgs, pMessage + nSize);
+
+			try
+			{
+				itr->second(interp, (size_t)fnID, parser, responses);
+			}
+			catch(std::exception& e)
+			{
+				write_exception(responses, (size_t)fnID, e.what());
+			}
+			catch(...)
+			{
+				write_exception(responses, (size_t)fnID, "unknown exception");
+			}
+		}
+
+		// the message is truncated to fit into the response ring
+		static void write_exception(shm_ring& responses, size_t fnID, std::string strMessage)
+		{
+			size_t nMaxMessage = responses.max_message() - detail::rpc_response_header - rpc_codec<std::string>::size(std::string());
+
+			if(strMessage.size() > nMaxMessage)
+				strMessage.resize(nMaxMessage);
+
+			char* p = responses.reserve(detail::rpc_response_header + rpc_codec<std::string>::size(strMessage));
+
+			rpc_codec<std::string>::write(detail::rpc_write_response(p, fnID, rpc_exception, 0), strMessage);
+			responses.commit();
+		}
+
+		// the result is written in place into the response
+		template<typename R>
+		static void call_typed(Interpreter& interp, size_t fnID, rpc_param_parser& parser, shm_ring& responses)
+		{
+			invoker_result<R> result = interp.template TryExecInvoker<R>(fnID, parser);
+
+			if(!result)
+			{
+				detail::rpc_write_response(responses.reserve(detail::rpc_response_header), fnID, result.error().code, result.error().arg_index);
+				responses.commit();
+				return;
+			}
+
+			char* p = responses.reserve(detail::rpc_response_header + rpc_codec<R>::size(result.value()));
+
+			rpc_codec<R>::write(detail::rpc_write_response(p, fnID, invoker_ok, 0), result.value());
+			responses.commit();
+		}
+
+		Interpreter& interp;
+		shm_channel& channel;
+		std::unordered_map<size_t, call_function> calls;
+		std::atomic<bool> bStop;
+	};
+
+	/** the client side of a shm_channel, it is used by one thread */
+	class rpc_client
+	{
+	public:
+		explicit rpc_client(shm_channel& channel)
+			: channel(channel), nPending(0)
+		{ }
+
+		/** write the call into the channel, the server isn't woken up until flush() */
+		template<typename... Args>
+		void post(size_t fnID, Args const&... args)
+		{
+			shm_ring& requests = channel.requests();
+			size_t nSize = detail::rpc_request_header + detail::rpc_args_size(args...);
+			char* p = NULL;
+
+			// the server may wait for the space of a response, so they are taken out meanwhile
+			while((p = requests.try_reserve(nSize)) == NULL)
+			{
+				if(!stash_response())
+					std::this_thread::yield();
+			}
+
+			detail::rpc_write_args(rpc_codec<boost::uint64_t>::write(p, (boost::uint64_t)fnID), args...);
+			requests.commit();
+			nPending++;
+		}
+
+		inline void flush()
+		{
+			channel.requests().notify();
+		}
+
+		/** the calls posted but not received yet */
+		inline size_t pending() const
+		{
+			return nPending;
+		}
+
+		/**
+		* Wait for the result of the oldest pending call, R is the return type of the function. The
+		* result of a function returning a std::string_view is received as a std::string.
+		*
+		* \throw std::runtime_error with the message of the exception the function threw
+		*/
+		template<typename R>
+		invoker_result<R> receive()
+		{
+			static_assert(!detail::rpc_is_view<R>::value, "receive the result of a view as an owning string");
+
+			size_t nSize = 0;
+			char const* pMessage = wait_response(nSize);
+			char const* pEnd = pMessage + nSize;
+			invoker_error err = take_status(pMessage, pEnd, nSize);
+
+			if(err.code != invoker_ok)
+			{
+				pop_response(nSize);
+				return invoker_result<R>::failure(err);
+			}
+
+			R value = detail::token_value<R>::make();
+			bool bOk = rpc_codec<R>::read(pMessage, pEnd, value);
+
+			pop_response(nSize);
+
+			if(!bOk)
+				throw std::runtime_error("the result of the RPC is truncated");
+
+			return invoker_result<R>(std::move(value));
+		}
+
+		/** post(), flush() and receive() of one call */
+		template<typename R, typename... Args>
+		inline invoker_result<R> call(size_t fnID, Args const&... args)
+		{
+			post(fnID, args...);
+			flush();
+			return receive<R>();
+		}
+
+	private:
+		char const* wait_response(size_t& nSize)
+		{
+			static const std::atomic<bool> bNever(false);
+
+			if(nPending == 0)
+				throw std::runtime_error("no RPC is pending");
+
+			nPending--;
+
+			if(!stashed.empty())
+			{
+				nSize = stashed.front().size();
+				return stashed.front().data();
+			}
+
+			return channel.responses().wait(nSize, bNever);
+		}
+
+		// release the response of wait_response()
+		inline void pop_response(size_t nSize)
+		{
+			if(!stashed.empty())
+				stashed.pop_front();
+			else
+				channel.responses().pop(nSize);
+		}
+
+		// copy the next response out of the ring for a later receive()
+		bool stash_response()
+		{
+			size_t nSize = 0;
+			char const* pMessage = channel.responses().peek(nSize);
+
+			if(pMessage == NULL)
+				return false;
+
+			stashed.push_back(std::string(pMessage, nSize));
+			channel.responses().pop(nSize);
+			return true;
+		}
+
+		// the status of the response of nSize bytes, the exception of the call is thrown after the
+		// response is popped
+		invoker_error take_status(char const*& p, char const* pEnd, size_t nSize)
+		{
+			boost::uint64_t fnID = 0;
+			boost::uint32_t nStatus = 0, nArgIndex = 0;
+			invoker_error err = {invoker_ok, 0, 0};
+
+			rpc_codec<boost::uint64_t>::read(p, pEnd, fnID);
+			rpc_codec<boost::uint32_t>::read(p, pEnd, nStatus);
+			rpc_codec<boost::uint32_t>::read(p, pEnd, nArgIndex);
+
+			if(nStatus == rpc_exception)
+			{
+				std::string strMessage;
+				rpc_codec<std::string>::read(p, pEnd, strMessage);
+				pop_response(nSize);
+				throw std::runtime_error(strMessage);
+			}
+
+			err.code = (invoker_errc)nStatus;
+			err.fnID = (size_t)fnID;
+			err.arg_index = nArgIndex;
+
+			return err;
+		}
+
+		rpc_client(rpc_client const&);
+		rpc_client& operator=(rpc_client const&);
+
+		shm_channel& channel;
+		size_t nPending;
+
+		/** the responses post() took out of the full ring, they are received first */
+		std::deque<std::string> stashed;
+	};
+
+#endif
+}
+
+#endif
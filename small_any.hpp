@@ -0,0 +1,273 @@
+/**
+ * (C) Copyright 2013 Dreamer
+ *
+ * this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+* A boost::any replacement with an inline buffer. The scalars and the strings are stored in the
+* buffer, only a bigger value or a value which may throw on moving goes to the heap. It is the
+* default result type of the interpreter, read it by DT::any_cast like boost::any_cast.
+*/
+
+#ifndef _DT_SMALL_ANY_
+#define _DT_SMALL_ANY_
+
+#include <new>
+#include <cstddef>
+#include <string>
+#include <typeinfo>
+#include <utility>
+#include <type_traits>
+
+#include <boost/any.hpp>
+
+namespace DT
+{
+	/** the inline buffer size of small_any, it fits the narrow and the wide strings */
+	const size_t small_any_buffer_size = sizeof(std::string) > sizeof(std::wstring) ? sizeof(std::string) : sizeof(std::wstring);
+
+	class small_any
+	{
+		typedef std::aligned_storage<small_any_buffer_size>::type storage_type;
+
+		// the operations of the stored type
+		struct value_manager
+		{
+			std::type_info const& (*type)();
+			void (*destroy)(storage_type& storage);
+			void (*copy)(storage_type const& from, storage_type& to);
+			void (*move)(storage_type& from, storage_type& to);
+			void* (*get)(storage_type& storage);
+		};
+
+		template<typename T>
+		struct is_inline
+			: std::integral_constant<bool, sizeof(T) <= sizeof(storage_type)
+				&& std::alignment_of<T>::value <= std::alignment_of<storage_type>::value
+				&& std::is_nothrow_move_constructible<T>::value>
+		{ };
+
+		template<typename T, bool bInline = is_inline<T>::value>
+		struct manager
+		{
+			static std::type_info const& type() { return typeid(T); }
+			static void destroy(storage_type& storage) { static_cast<T*>(get(storage))->~T(); }
+			static void copy(storage_type const& from, storage_type& to) { ::new (static_cast<void*>(&to)) T(*static_cast<T const*>(get(const_cast<storage_type&>(from)))); }
+			static void move(storage_type& from, storage_type& to) { ::new (static_cast<void*>(&to)) T(std::move(*static_cast<T*>(get(from)))); destroy(from); }
+			static void* get(storage_type& storage) { return static_cast<void*>(&storage); }
+
+			template<typename... Args>
+			static void create(storage_type& storage, Args&&... args) { ::new (static_cast<void*>(&storage)) T(std::forward<Args>(args)...); }
+		};
+
+		// the buffer keeps the pointer of the heap value
+		template<typename T>
+		struct manager<T, false>
+		{
+			static std::type_info const& type() { return typeid(T); }
+			static void destroy(storage_type& storage) { delete static_cast<T*>(get(storage)); }
+			static void copy(storage_type const& from, storage_type& to) { pointer(to) = new T(*static_cast<T const*>(get(const_cast<storage_type&>(from)))); }
+			static void move(storage_type& from, storage_type& to) { pointer(to) = pointer(from); }
+			static void* get(storage_type& storage) { return pointer(storage); }
+
+			template<typename... Args>
+			static void create(storage_type& storage, Args&&... args) { pointer(storage) = new T(std::forward<Args>(args)...); }
+
+			static void*& pointer(storage_type& storage) { return *static_cast<void**>(static_cast<void*>(&storage)); }
+		};
+
+		template<typename T>
+		static value_manager const* manager_of()
+		{
+			static const value_manager vtable = {&manager<T>::type, &manager<T>::destroy, &manager<T>::copy, &manager<T>::move, &manager<T>::get};
+			return &vtable;
+		}
+
+		template<typename T>
+		struct is_value
+			: std::integral_constant<bool, !std::is_same<typename std::decay<T>::type, small_any>::value>
+		{ };
+
+	public:
+		small_any() : pManager(NULL)
+		{ }
+
+		small_any(small_any const& other) : pManager(other.pManager)
+		{
+			if(pManager != NULL)
+				pManager->copy(other.storage, storage);
+		}
+
+		small_any(small_any&& other) noexcept : pManager(other.pManager)
+		{
+			if(pManager != NULL)
+			{
+				pManager->move(other.storage, storage);
+				other.pManager = NULL;
+			}
+		}
+
+		template<typename T, typename = typename std::enable_if<is_value<T>::value>::type>
+		small_any(T&& value) : pManager(NULL)
+		{
+			emplace<typename std::decay<T>::type>(std::forward<T>(value));
+		}
+
+		~small_any()
+		{
+			clear();
+		}
+
+		small_any& operator=(small_any const& other)
+		{
+			if(this != &other)
+			{
+				small_any copy(other);
+				*this = std::move(copy);
+			}
+
+			return *this;
+		}
+
+		small_any& operator=(small_any&& other) noexcept
+		{
+			if(this != &other)
+			{
+				clear();
+
+				if(other.pManager != NULL)
+				{
+					other.pManager->move(other.storage, storage);
+					pManager = other.pManager;
+					other.pManager = NULL;
+				}
+			}
+
+			return *this;
+		}
+
+		// the value is constructed in place, no temporary small_any
+		template<typename T, typename = typename std::enable_if<is_value<T>::value>::type>
+		small_any& operator=(T&& value)
+		{
+			emplace<typename std::decay<T>::type>(std::forward<T>(value));
+			return *this;
+		}
+
+		template<typename T, typename... Args>
+		T& emplace(Args&&... args)
+		{
+			clear();
+			manager<T>::create(storage, std::forward<Args>(args)...);
+			pManager = manager_of<T>();
+
+			return *static_cast<T*>(pManager->get(storage));
+		}
+
+		inline bool empty() const
+		{
+			return pManager == NULL;
+		}
+
+		inline void clear()
+		{
+			if(pManager != NULL)
+			{
+				pManager->destroy(storage);
+				pManager = NULL;
+			}
+		}
+
+		inline std::type_info const& type() const
+		{
+			return pManager != NULL ? pManager->type() : typeid(void);
+		}
+
+		void swap(small_any& other)
+		{
+			small_any temp(std::move(other));
+			other = std::move(*this);
+			*this = std::move(temp);
+		}
+
+		/** the stored value if it is a T, otherwise NULL */
+		template<typename T>
+		inline T* get_if()
+		{
+			return pManager == manager_of<T>() || (pManager != NULL && pManager->type() == typeid(T)) ? static_cast<T*>(pManager->get(storage)) : NULL;
+		}
+
+		template<typename T>
+		inline T const* get_if() const
+		{
+			return const_cast<small_any*>(this)->get_if<T>();
+		}
+
+	private:
+		storage_type storage;
+		value_manager const* pManager;
+	};
+
+	/** the pointer to the value of the type T, NULL if the any holds another type */
+	template<typename T>
+	inline T* any_cast(small_any* operand)
+	{
+		return operand != NULL ? operand->get_if<T>() : NULL;
+	}
+
+	template<typename T>
+	inline T const* any_cast(small_any const* operand)
+	{
+		return operand != NULL ? operand->get_if<T>() : NULL;
+	}
+
+	/** \throw boost::bad_any_cast if the any holds another type, like boost::any_cast */
+	template<typename T>
+	inline T any_cast(small_any const& operand)
+	{
+		typedef typename std::remove_cv<typename std::remove_reference<T>::type>::type value_type;
+		value_type const* pValue = operand.get_if<value_type>();
+
+		if(pValue == NULL)
+			throw boost::bad_any_cast();
+
+		return *pValue;
+	}
+
+	template<typename T>
+	inline T any_cast(small_any& operand)
+	{
+		typedef typename std::remove_cv<typename std::remove_reference<T>::type>::type value_type;
+		value_type* pValue = operand.get_if<value_type>();
+
+		if(pValue == NULL)
+			throw boost::bad_any_cast();
+
+		return *pValue;
+	}
+
+	template<typename T>
+	inline T any_cast(small_any&& operand)
+	{
+		typedef typename std::remove_cv<typename std::remove_reference<T>::type>::type value_type;
+		value_type* pValue = operand.get_if<value_type>();
+
+		if(pValue == NULL)
+			throw boost::bad_any_cast();
+
+		return std::move(*pValue);
+	}
+}
+
+#endif
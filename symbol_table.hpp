@@ -0,0 +1,109 @@
+/**
+ * (C) Copyright 2013 Dreamer
+ *
+ * this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+* The interned names. Every distinct name is stored once and gets a compact symbol ID, the
+* position of the name in the table. A symbol and the address of its name never change, so the
+* name can be handed out by reference and kept by the readers without a copy.
+*/
+
+#ifndef _DT_SYMBOL_TABLE_
+#define _DT_SYMBOL_TABLE_
+
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <string>
+#include <unordered_map>
+
+namespace DT
+{
+	/** the compact ID of an interned name */
+	typedef size_t symbol_id;
+
+	/** the name isn't interned */
+	const symbol_id no_symbol = (symbol_id)-1;
+
+	/**
+	* The table isn't synchronized, the writer locks it against the other writers. A reader may
+	* keep the address of a name while the others are interned, the deque doesn't move them.
+	*/
+	template<typename String = std::string, typename Hasher = std::hash<String> >
+	class symbol_table
+	{
+		// the index keys are the interned names, so every name is stored once
+		struct name_hash
+		{
+			Hasher hash_fn;
+
+			inline size_t operator()(String const* pName) const
+			{
+				return hash_fn(*pName);
+			}
+		};
+
+		struct name_equal
+		{
+			inline bool operator()(String const* pLeft, String const* pRight) const
+			{
+				return *pLeft == *pRight;
+			}
+		};
+
+		typedef std::unordered_map<String const*, symbol_id, name_hash, name_equal> name_index;
+
+	public:
+		/** the symbol of the name, it is added if the name is new */
+		symbol_id intern(String const& name)
+		{
+			typename name_index::const_iterator itr = index.find(&name);
+
+			if(itr != index.end())
+				return itr->second;
+
+			symbol_id symbol = names.size();
+			names.push_back(name);
+			index.insert(typename name_index::value_type(&names.back(), symbol));
+
+			return symbol;
+		}
+
+		/** \return no_symbol if the name isn't interned */
+		inline symbol_id find(String const& name) const
+		{
+			typename name_index::const_iterator itr = index.find(&name);
+
+			return itr != index.end() ? itr->second : no_symbol;
+		}
+
+		/** the interned name, the symbol must be returned by intern() */
+		inline String const& name(symbol_id symbol) const
+		{
+			return names[symbol];
+		}
+
+		inline size_t size() const
+		{
+			return names.size();
+		}
+
+	private:
+		std::deque<String> names;
+		name_index index;
+	};
+}
+
+#endif
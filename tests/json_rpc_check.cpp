@@ -0,0 +1,126 @@
+/**
+ * (C) Copyright 2013 Dreamer
+ *
+ * this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+* The check of json_rpc_server: the malformed JSON is a parse error and isn't called, the params
+* must match the parameters, the notifications have no response and an empty batch is an invalid
+* request. It returns the count of the failed cases.
+*/
+
+#include <cstdio>
+#include <string>
+
+#include "json_rpc.hpp"
+
+typedef DT::interpreter<DT::json_param_parser, int> json_interpreter;
+
+static int g_nLast = 0;
+static int g_nFailed = 0;
+
+int add(int a, int b)
+{
+	return a + b;
+}
+
+int set_last(int n)
+{
+	g_nLast = n;
+	return n;
+}
+
+void check(DT::json_rpc_server<json_interpreter>& server, char const* szRequest, char const* szExpected)
+{
+	std::string response = server.handle(szRequest);
+
+	if(response != szExpected)
+	{
+		std::printf("FAILED %s\n  got      %s\n  expected %s\n", szRequest, response.c_str(), szExpected);
+		g_nFailed++;
+	}
+}
+
+void check_last(int nExpected, char const* szCase)
+{
+	if(g_nLast != nExpected)
+	{
+		std::printf("FAILED %s: set_last got %d, expected %d\n", szCase, g_nLast, nExpected);
+		g_nFailed++;
+	}
+}
+
+int main()
+{
+	json_interpreter interp;
+	DT::json_rpc_server<json_interpreter> server(interp);
+
+	server.register_function("add", &add);
+	server.register_function("set_last", &set_last);
+
+	const char* szParseError = "{\"jsonrpc\":\"2.0\",\"id\":null,\"error\":{\"code\":-32700,\"message\":\"parse error\"}}";
+
+	// the calls
+	check(server, "{\"jsonrpc\":\"2.0\",\"method\":\"add\",\"params\":[1,2],\"id\":1}", "{\"jsonrpc\":\"2.0\",\"id\":1,\"result\":3}");
+	check(server, "{\"jsonrpc\":\"2.0\",\"method\":\"add\",\"params\":[1,null],\"id\":2}", "{\"jsonrpc\":\"2.0\",\"id\":2,\"result\":1}");
+	check(server, "{\"jsonrpc\":\"2.0\",\"method\":\"add\",\"params\":[-0.0e0,2],\"id\":3}",
+		"{\"jsonrpc\":\"2.0\",\"id\":3,\"error\":{\"code\":-32602,\"message\":\"invalid params\",\"data\":{\"index\":0}}}");
+
+	// the malformed JSON isn't called
+	check(server, "{\"jsonrpc\":\"2.0\",\"method\":\"add\",\"params\":[1,2,],\"id\":4}", szParseError);
+	check(server, "{\"jsonrpc\":\"2.0\",\"method\":\"add\",\"params\":[1},\"id\":5}", szParseError);
+	check(server, "{\"jsonrpc\":\"2.0\",\"method\":\"add\",\"params\":[1 2],\"id\":6}", szParseError);
+	check(server, "{\"jsonrpc\":\"2.0\",\"method\":\"add\",\"params\":[01,2],\"id\":7}", szParseError);
+	check(server, "{\"jsonrpc\":\"2.0\",\"method\":\"add\",\"params\":[1.,2],\"id\":8}", szParseError);
+	check(server, "{\"jsonrpc\":\"2.0\",\"method\":\"add\",\"params\":[1,2],\"id\":9,\"x\":{\"a\" 1}}", szParseError);
+	check(server, "{\"jsonrpc\":\"2.0\",\"method\":\"add\",\"params\":[1,2],\"id\":10,\"x\":[[[]]}", szParseError);
+	check(server, "{\"jsonrpc\":\"2.0\",\"method\":\"set_last\",\"params\":[5,],\"id\":11}", szParseError);
+	check(server, "[{\"jsonrpc\":\"2.0\",\"method\":\"set_last\",\"params\":[6]},{\"jsonrpc\":\"2.0\",\"method\":\"add\",\"params\":[1 2]}]", szParseError);
+	check_last(0, "the malformed requests");
+
+	// the params must match the parameters
+	check(server, "{\"jsonrpc\":\"2.0\",\"method\":\"add\",\"params\":[1,2,3],\"id\":12}",
+		"{\"jsonrpc\":\"2.0\",\"id\":12,\"error\":{\"code\":-32602,\"message\":\"invalid params\",\"data\":{\"index\":2}}}");
+	check(server, "{\"jsonrpc\":\"2.0\",\"method\":\"add\",\"params\":[1],\"id\":13}",
+		"{\"jsonrpc\":\"2.0\",\"id\":13,\"error\":{\"code\":-32602,\"message\":\"invalid params\",\"data\":{\"index\":1}}}");
+	check(server, "{\"jsonrpc\":\"2.0\",\"method\":\"add\",\"params\":[],\"id\":14}",
+		"{\"jsonrpc\":\"2.0\",\"id\":14,\"error\":{\"code\":-32602,\"message\":\"invalid params\",\"data\":{\"index\":0}}}");
+	check(server, "{\"jsonrpc\":\"2.0\",\"method\":\"add\",\"id\":15}",
+		"{\"jsonrpc\":\"2.0\",\"id\":15,\"error\":{\"code\":-32602,\"message\":\"invalid params\",\"data\":{\"index\":0}}}");
+
+	// the notifications have no response, even for an error
+	check(server, "{\"jsonrpc\":\"2.0\",\"method\":\"set_last\",\"params\":[7]}", "");
+	check_last(7, "a notification");
+	check(server, "{\"jsonrpc\":\"2.0\",\"method\":\"add\",\"params\":[1]}", "");
+	check(server, "[{\"jsonrpc\":\"2.0\",\"method\":\"set_last\",\"params\":[8]},{\"jsonrpc\":\"2.0\",\"method\":\"nope\"}]", "");
+	check_last(8, "a batch of notifications");
+	check(server, "[{\"jsonrpc\":\"2.0\",\"method\":\"set_last\",\"params\":[9]},{\"jsonrpc\":\"2.0\",\"method\":\"add\",\"params\":[1,2],\"id\":16}]",
+		"[{\"jsonrpc\":\"2.0\",\"id\":16,\"result\":3}]");
+	check_last(9, "a notification in a batch");
+
+	// the batches
+	check(server, "[]", "{\"jsonrpc\":\"2.0\",\"id\":null,\"error\":{\"code\":-32600,\"message\":\"empty batch\"}}");
+	check(server, " [ ] ", "{\"jsonrpc\":\"2.0\",\"id\":null,\"error\":{\"code\":-32600,\"message\":\"empty batch\"}}");
+	check(server, "[1]", "[{\"jsonrpc\":\"2.0\",\"id\":null,\"error\":{\"code\":-32600,\"message\":\"the request isn't an object\"}}]");
+	check(server, "[{\"jsonrpc\":\"2.0\",\"method\":\"add\",\"params\":[1,2],\"id\":17},]", szParseError);
+
+	// the nesting limit
+	std::string strDeep = "{\"jsonrpc\":\"2.0\",\"method\":\"add\",\"params\":[1,2],\"id\":18,\"x\":" + std::string(10000, '[') + std::string(10000, ']') + "}";
+	check(server, strDeep.c_str(), szParseError);
+
+	if(g_nFailed == 0)
+		std::printf("json_rpc_check passed\n");
+
+	return g_nFailed;
+}
@@ -0,0 +1,160 @@
+/**
+ * (C) Copyright 2013 Dreamer
+ *
+ * this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+* The check of rpc_server and rpc_client over a small channel: more calls are posted than the
+* response ring holds before receive(), a truncated request and a function which throws still get
+* their response, an oversized exception message is truncated, and the channel serves the calls
+* after each of them. It returns the count of the failed cases.
+*/
+
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include <unistd.h>
+
+#include "shm_rpc.hpp"
+
+typedef DT::interpreter<DT::rpc_param_parser, int> rpc_interpreter;
+
+static int g_nFailed = 0;
+
+int add(int a, int b)
+{
+	return a + b;
+}
+
+int fail(int nLength)
+{
+	throw std::runtime_error(std::string(nLength, 'x'));
+}
+
+int fail_unknown(int n)
+{
+	throw n;
+}
+
+void check(bool bOk, char const* szCase)
+{
+	if(!bOk)
+	{
+		std::printf("FAILED %s\n", szCase);
+		g_nFailed++;
+	}
+}
+
+// the message of the exception the call threw, empty if it didn't throw
+std::string call_error(DT::rpc_client& client, size_t fnID, int n)
+{
+	try
+	{
+		client.call<int>(fnID, n);
+	}
+	catch(std::runtime_error& e)
+	{
+		return e.what();
+	}
+
+	return std::string();
+}
+
+int main()
+{
+	const std::string strName = "/dt_shm_rpc_check_" + std::to_string(::getpid());
+	std::unique_ptr<DT::shm_channel> pChannel(DT::shm_channel::create(strName, 4096));
+	std::unique_ptr<DT::shm_channel> pClientChannel(DT::shm_channel::open(strName));
+
+	rpc_interpreter interp;
+	DT::rpc_server<rpc_interpreter> server(interp, *pChannel);
+	DT::rpc_client client(*pClientChannel);
+
+	size_t nAdd = server.register_function("add", &add);
+	size_t nFail = server.register_function("fail", &fail);
+	size_t nFailUnknown = server.register_function("fail_unknown", &fail_unknown);
+
+	std::thread serving([&server] { server.run(); });
+
+	// more calls than the response ring holds
+	const int nCalls = 10000;
+	long nSum = 0;
+
+	for(int i = 0; i < nCalls; i++)
+		client.post(nAdd, i, 1);
+
+	client.flush();
+
+	for(int i = 0; i < nCalls; i++)
+		nSum += client.receive<int>().value();
+
+	check(nSum == (long)nCalls * (nCalls + 1) / 2, "the calls posted before receive()");
+	check(client.pending() == 0, "the pending calls after receive()");
+
+	// a truncated request gets an invalid argument response
+	static const std::atomic<bool> bNever(false);
+	size_t nSize = 0;
+	boost::uint32_t nStatus = 0;
+
+	std::memset(pClientChannel->requests().reserve(4), 0, 4);
+	pClientChannel->requests().commit();
+	pClientChannel->requests().notify();
+
+	char const* pResponse = pClientChannel->responses().wait(nSize, bNever);
+	std::memcpy(&nStatus, pResponse + sizeof(boost::uint64_t), sizeof(nStatus));
+	pClientChannel->responses().pop(nSize);
+
+	check(nStatus == DT::invoker_invalid_argument, "a truncated request");
+	check(client.call<int>(nAdd, 2, 3).value() == 5, "a call after a truncated request");
+
+	// the exceptions of the functions
+	check(call_error(client, nFail, 3) == "xxx", "a function which throws");
+	check(call_error(client, nFailUnknown, 42) == "unknown exception", "a function which throws an int");
+
+	std::string strMessage = call_error(client, nFail, 100000);
+	check(!strMessage.empty() && strMessage.size() < pClientChannel->responses().max_message(), "an oversized exception message");
+	check(client.call<int>(nAdd, 2, 4).value() == 6, "a call after an oversized exception message");
+
+	for(int i = 0; i < nCalls; i++)
+		client.post(i % 2 == 0 ? nFail : nFailUnknown, 1000);
+
+	client.flush();
+
+	int nThrown = 0;
+	for(int i = 0; i < nCalls; i++)
+	{
+		try
+		{
+			client.receive<int>();
+		}
+		catch(std::runtime_error&)
+		{
+			nThrown++;
+		}
+	}
+
+	check(nThrown == nCalls, "the exceptions posted before receive()");
+
+	server.stop();
+	serving.join();
+
+	if(g_nFailed == 0)
+		std::printf("shm_rpc_check passed\n");
+
+	return g_nFailed;
+}
@@ -0,0 +1,208 @@
+/**
+ * (C) Copyright 2013 Dreamer
+ *
+ * this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+* Convert a text token to the parameter type. The integers and the floating points are parsed by
+* std::from_chars, it is locale independent and doesn't build any stream. The wide tokens are
+* narrowed into a stack buffer first. The other types still go to boost::lexical_cast.
+*
+* Unlike lexical_cast, the from_chars path is strict: an unsigned type rejects the '-' sign.
+*
+* A string of the token character type is assigned from the token directly. A std::pmr string is
+* allocated from current_parse_resource(), i.e. the parse_arena of the call.
+*/
+
+#ifndef _DT_TOKEN_CAST_
+#define _DT_TOKEN_CAST_
+
+#include <cstddef>
+#include <string>
+#include <typeinfo>
+#include <type_traits>
+
+#include <boost/lexical_cast.hpp>
+#include <boost/throw_exception.hpp>
+
+#include "parse_arena.hpp"
+
+#if __cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)
+#if defined(__has_include)
+#if __has_include(<charconv>)
+#include <charconv>
+#define DT_TOKEN_CAST_FROM_CHARS
+#endif
+#endif
+#endif
+
+namespace DT
+{
+	namespace detail
+	{
+		/** the token delimiters of the interpreter scripts */
+		template<typename Char>
+		inline bool is_token_delim(Char c)
+		{
+			return c == Char(' ') || c == Char('\t') || c == Char('\n') || c == Char('\r');
+		}
+
+		template<typename T>
+		struct is_char_type
+			: std::integral_constant<bool, std::is_same<T,char>::value || std::is_same<T,signed char>::value
+				|| std::is_same<T,unsigned char>::value || std::is_same<T,wchar_t>::value
+				|| std::is_same<T,char16_t>::value || std::is_same<T,char32_t>::value>
+		{ };
+
+		// the types parsed by std::from_chars. bool and the char types keep the lexical_cast semantic
+		template<typename T>
+		struct is_from_chars_number
+#if defined(DT_TOKEN_CAST_FROM_CHARS)
+			: std::integral_constant<bool, (std::is_integral<T>::value && !std::is_same<T,bool>::value && !is_char_type<T>::value)
+#if defined(__cpp_lib_to_chars)
+				|| std::is_floating_point<T>::value
+#endif
+				>
+#else
+			: std::false_type
+#endif
+		{ };
+
+		template<typename Target, typename Char, bool bNumber = is_from_chars_number<Target>::value>
+		struct token_caster
+		{
+			static inline bool apply(Char const* first, Char const* last, Target& value)
+			{
+				return boost::conversion::try_lexical_convert(first, (std::size_t)(last - first), value);
+			}
+		};
+
+		// a string of the token characters is the token itself
+		template<typename Char, typename Traits, typename Alloc>
+		struct token_caster<std::basic_string<Char,Traits,Alloc>, Char, false>
+		{
+			static inline bool apply(Char const* first, Char const* last, std::basic_string<Char,Traits,Alloc>& value)
+			{
+				value.assign(first, last);
+				return true;
+			}
+		};
+
+		// the initial value of the conversion, a std::pmr string gets the resource of the call
+		template<typename Target>
+		struct token_value
+		{
+			static inline Target make()
+			{
+				return Target();
+			}
+		};
+
+#ifdef DT_PARSE_ARENA
+		template<typename Char, typename Traits>
+		struct token_value< std::basic_string<Char,Traits,std::pmr::polymorphic_allocator<Char> > >
+		{
+			static inline std::basic_string<Char,Traits,std::pmr::polymorphic_allocator<Char> > make()
+			{
+				return std::basic_string<Char,Traits,std::pmr::polymorphic_allocator<Char> >(current_parse_resource());
+			}
+		};
+#endif
+
+#if defined(DT_TOKEN_CAST_FROM_CHARS)
+		template<typename Target>
+		struct token_caster<Target, char, true>
+		{
+			static inline bool apply(char const* first, char const* last, Target& value)
+			{
+				//from_chars doesn't take the '+' sign, lexical_cast does
+				if(last - first > 1 && *first == '+' && *(first + 1) != '-')
+					++first;
+
+				std::from_chars_result result = std::from_chars(first, last, value);
+
+				return result.ec == std::errc() && result.ptr == last;
+			}
+		};
+
+		// the wide token of a number is ASCII, narrow it on the stack and parse it as char
+		template<typename Target, typename Char>
+		struct token_caster<Target, Char, true>
+		{
+			static inline bool apply(Char const* first, Char const* last, Target& value)
+			{
+				char szBuf[64];
+				std::size_t nSize = (std::size_t)(last - first);
+
+				if(nSize > sizeof(szBuf))
+					return token_caster<Target, Char, false>::apply(first, last, value);
+
+				for(std::size_t i = 0; i < nSize; i++)
+				{
+					if((unsigned long)first[i] > 0x7F)
+						return false;
+
+					szBuf[i] = (char)first[i];
+				}
+
+				return token_caster<Target, char, true>::apply(szBuf, szBuf + nSize, value);
+			}
+		};
+#endif
+	}
+
+	/** the strings and the string views, a token is taken as one of them without the parsing */
+	template<typename T>
+	struct is_token_text : std::false_type
+	{ };
+
+	template<typename Char, typename Traits, typename Alloc>
+	struct is_token_text< std::basic_string<Char,Traits,Alloc> > : std::true_type
+	{ };
+
+#ifdef __cpp_lib_string_view
+	template<typename Char, typename Traits>
+	struct is_token_text< std::basic_string_view<Char,Traits> > : std::true_type
+	{ };
+#endif
+
+	/**
+	* Convert the token [first, last) to Target without throwing.
+	*
+	* \return false if the token isn't a valid Target, the value is unspecified then
+	*/
+	template<typename Target, typename Char>
+	inline bool try_token_cast(Char const* first, Char const* last, Target& value)
+	{
+		return detail::token_caster<Target, Char>::apply(first, last, value);
+	}
+
+	/**
+	* Convert the token [first, last) to Target.
+	*
+	* \throw boost::bad_lexical_cast if the token isn't a valid Target
+	*/
+	template<typename Target, typename Char>
+	inline Target token_cast(Char const* first, Char const* last)
+	{
+		Target value = detail::token_value<Target>::make();
+
+		if(!try_token_cast(first, last, value))
+			boost::throw_exception(boost::bad_lexical_cast(typeid(Char const*), typeid(Target)));
+
+		return value;
+	}
+}
+
+#endif
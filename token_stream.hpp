@@ -0,0 +1,234 @@
+/**
+ * (C) Copyright 2013 Dreamer
+ *
+ * this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+* The streaming tokenizer for the interpreter. A token_stream is the script of an istream or of a
+* memory range such as a mapped_file. token_stream_iterator reads the stream in bounded chunks
+* while the commands are parsed, so a script is run before it is read completely and it never
+* has to fit in memory. A token crossing the chunk boundary is joined from the both chunks.
+*/
+
+#ifndef _DT_TOKEN_STREAM_
+#define _DT_TOKEN_STREAM_
+
+#include <cstddef>
+#include <istream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "token_cast.hpp"
+
+namespace DT
+{
+	/** the default chunk size of a token_stream in characters */
+	const size_t token_stream_chunk_size = 64 * 1024;
+
+	/**
+	* The script to be tokenized by token_stream_iterator. It refers to the stream or the memory,
+	* they must outlive the parsing.
+	*/
+	template<typename Char>
+	class token_stream
+	{
+	public:
+		typedef std::basic_istream<Char> stream_type;
+
+		/** read the stream by nChunkSize characters, a smaller chunk starts the execution sooner */
+		explicit token_stream(stream_type& stream, size_t nChunkSize = token_stream_chunk_size)
+			: pStream(&stream), pBegin(NULL), pEnd(NULL), nChunkSize(nChunkSize > 0 ? nChunkSize : 1)
+		{ }
+
+		/** the memory is tokenized where it is, e.g. a mapped_file which the OS pages in on demand */
+		token_stream(Char const* pBegin, Char const* pEnd)
+			: pStream(NULL), pBegin(pBegin), pEnd(pEnd), nChunkSize(0)
+		{ }
+
+		inline stream_type* stream() const { return pStream; }
+		inline Char const* begin() const { return pBegin; }
+		inline Char const* end() const { return pEnd; }
+		inline size_t chunk_size() const { return nChunkSize; }
+
+	private:
+		stream_type* pStream;
+		Char const* pBegin;
+		Char const* pEnd;
+		size_t nChunkSize;
+	};
+
+	template<typename Char>
+	inline token_stream<Char> make_token_stream(std::basic_istream<Char>& stream, size_t nChunkSize = token_stream_chunk_size)
+	{
+		return token_stream<Char>(stream, nChunkSize);
+	}
+
+	namespace detail
+	{
+		// the tokenizing state shared by the copies of a token_stream_iterator
+		template<typename Char>
+		class token_stream_reader
+		{
+		public:
+			explicit token_stream_reader(token_stream<Char> const& input)
+				: pStream(input.stream()), pAt(input.begin()), pEnd(input.end()), bEnd(false)
+			{
+				if(pStream != NULL)
+				{
+					buffer.resize(input.chunk_size());
+					pAt = pEnd = buffer.data();
+				}
+
+				next();
+			}
+
+			inline bool at_end() const
+			{
+				return bEnd;
+			}
+
+			inline std::basic_string<Char> const& token() const
+			{
+				return current;
+			}
+
+			/** move to the next token, the last chunk may end inside it */
+			void next()
+			{
+				current.clear();
+
+				//skip the delimiters
+				for(;;)
+				{
+					while(pAt != pEnd && is_token_delim(*pAt))
+						++pAt;
+
+					if(pAt != pEnd)
+						break;
+
+					if(!fill())
+					{
+						bEnd = true;
+						return;
+					}
+				}
+
+				for(;;)
+				{
+					Char const* pFirst = pAt;
+
+					while(pAt != pEnd && !is_token_delim(*pAt))
+						++pAt;
+
+					current.append(pFirst, pAt);
+
+					if(pAt != pEnd || !fill())
+						return;
+				}
+			}
+
+		private:
+			// read the next chunk of the stream, the memory is a single chunk
+			bool fill()
+			{
+				if(pStream == NULL)
+					return false;
+
+				pStream->read(buffer.data(), (std::streamsize)buffer.size());
+
+				size_t nRead = (size_t)pStream->gcount();
+				pAt = buffer.data();
+				pEnd = pAt + nRead;
+
+				return nRead > 0;
+			}
+
+			std::basic_istream<Char>* pStream;
+			std::vector<Char> buffer;
+			Char const* pAt;
+			Char const* pEnd;
+			std::basic_string<Char> current;
+			bool bEnd;
+		};
+	}
+
+	/**
+	* The input iterator of the tokens of a token_stream. The copies share the reading position,
+	* and the token is valid until the iterator is incremented. The end iterator is default
+	* constructed.
+	*/
+	template<typename Char>
+	class token_stream_iterator
+	{
+	public:
+		typedef std::input_iterator_tag iterator_category;
+		typedef std::basic_string<Char> value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef value_type const* pointer;
+		typedef value_type const& reference;
+
+		token_stream_iterator()
+		{ }
+
+		explicit token_stream_iterator(token_stream<Char> const& input)
+			: pReader(std::make_shared< detail::token_stream_reader<Char> >(input))
+		{ }
+
+		inline reference operator*() const
+		{
+			return pReader->token();
+		}
+
+		inline pointer operator->() const
+		{
+			return &pReader->token();
+		}
+
+		inline token_stream_iterator& operator++()
+		{
+			pReader->next();
+			return *this;
+		}
+
+		// the copy shares the position, it is only good for the comparison
+		inline token_stream_iterator operator++(int)
+		{
+			token_stream_iterator prev(*this);
+			++*this;
+			return prev;
+		}
+
+		inline bool operator==(token_stream_iterator const& other) const
+		{
+			return at_end() == other.at_end() && (at_end() || pReader == other.pReader);
+		}
+
+		inline bool operator!=(token_stream_iterator const& other) const
+		{
+			return !(*this == other);
+		}
+
+	private:
+		inline bool at_end() const
+		{
+			return !pReader || pReader->at_end();
+		}
+
+		std::shared_ptr< detail::token_stream_reader<Char> > pReader;
+	};
+}
+
+#endif
@@ -0,0 +1,237 @@
+/**
+ * (C) Copyright 2013 Dreamer
+ *
+ * this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+* The zero-copy tokenizer for the interpreter. token_view_iterator walks the " \t\n\r" separated
+* tokens of the input and hands out string_view tokens pointing into the input, so the input must
+* outlive the iterator. The delimiters are searched with AVX2/SSE2 when the compiler targets them,
+* otherwise with the plain loop.
+*/
+
+#ifndef _DT_TOKEN_VIEW_
+#define _DT_TOKEN_VIEW_
+
+#include <cstddef>
+#include <iterator>
+#include <string>
+#include <string_view>
+
+#include "token_cast.hpp"
+
+#if defined(__AVX2__)
+#define DT_TOKEN_VIEW_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DT_TOKEN_VIEW_SSE2
+#include <emmintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace DT
+{
+	namespace detail
+	{
+		inline unsigned lowest_bit(unsigned mask)
+		{
+#ifdef _MSC_VER
+			unsigned long nIndex;
+			_BitScanForward(&nIndex, mask);
+			return (unsigned)nIndex;
+#else
+			return (unsigned)__builtin_ctz(mask);
+#endif
+		}
+
+#if defined(DT_TOKEN_VIEW_AVX2)
+		typedef __m256i simd_block;
+
+		inline simd_block simd_load(void const* p) { return _mm256_loadu_si256((__m256i const*)p); }
+		inline unsigned simd_mask(simd_block v) { return (unsigned)_mm256_movemask_epi8(v); }
+		inline simd_block simd_or(simd_block a, simd_block b) { return _mm256_or_si256(a, b); }
+
+		template<size_t CharSize> struct simd_char;
+
+		template<> struct simd_char<1>
+		{
+			static inline simd_block eq(simd_block v, int c) { return _mm256_cmpeq_epi8(v, _mm256_set1_epi8((char)c)); }
+		};
+
+		template<> struct simd_char<2>
+		{
+			static inline simd_block eq(simd_block v, int c) { return _mm256_cmpeq_epi16(v, _mm256_set1_epi16((short)c)); }
+		};
+
+		template<> struct simd_char<4>
+		{
+			static inline simd_block eq(simd_block v, int c) { return _mm256_cmpeq_epi32(v, _mm256_set1_epi32(c)); }
+		};
+#elif defined(DT_TOKEN_VIEW_SSE2)
+		typedef __m128i simd_block;
+
+		inline simd_block simd_load(void const* p) { return _mm_loadu_si128((__m128i const*)p); }
+		inline unsigned simd_mask(simd_block v) { return (unsigned)_mm_movemask_epi8(v); }
+		inline simd_block simd_or(simd_block a, simd_block b) { return _mm_or_si128(a, b); }
+
+		template<size_t CharSize> struct simd_char;
+
+		template<> struct simd_char<1>
+		{
+			static inline simd_block eq(simd_block v, int c) { return _mm_cmpeq_epi8(v, _mm_set1_epi8((char)c)); }
+		};
+
+		template<> struct simd_char<2>
+		{
+			static inline simd_block eq(simd_block v, int c) { return _mm_cmpeq_epi16(v, _mm_set1_epi16((short)c)); }
+		};
+
+		template<> struct simd_char<4>
+		{
+			static inline simd_block eq(simd_block v, int c) { return _mm_cmpeq_epi32(v, _mm_set1_epi32(c)); }
+		};
+#endif
+
+		/**
+		* Find the first delimiter (bDelim is true) or the first non-delimiter (bDelim is false)
+		* in [pos, last). Return last if there isn't one.
+		*/
+		template<bool bDelim, typename Char>
+		inline Char const* scan_token(Char const* pos, Char const* last)
+		{
+#if defined(DT_TOKEN_VIEW_AVX2) || defined(DT_TOKEN_VIEW_SSE2)
+			typedef simd_char<sizeof(Char)> simd;
+			const size_t nBlockChars = sizeof(simd_block) / sizeof(Char);
+			const unsigned nFullMask = (unsigned)((1ULL << sizeof(simd_block)) - 1);
+
+			while((size_t)(last - pos) >= nBlockChars)
+			{
+				simd_block v = simd_load(pos);
+				unsigned mask = simd_mask(simd_or(simd_or(simd::eq(v, ' '), simd::eq(v, '\t')),
+					simd_or(simd::eq(v, '\n'), simd::eq(v, '\r'))));
+
+				if(!bDelim)
+					mask = ~mask & nFullMask;
+
+				if(mask != 0)
+					return pos + lowest_bit(mask) / sizeof(Char);
+
+				pos += nBlockChars;
+			}
+#endif
+			while(pos != last && is_token_delim(*pos) != bDelim)
+				++pos;
+
+			return pos;
+		}
+	}
+
+	template<typename Char>
+	class token_view_iterator
+	{
+	public:
+		typedef std::forward_iterator_tag iterator_category;
+		typedef std::basic_string_view<Char> value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef value_type const* pointer;
+		typedef value_type const& reference;
+
+		token_view_iterator()
+			: itr_last(NULL)
+		{ }
+
+		token_view_iterator(Char const* first, Char const* last)
+			: itr_last(last)
+		{
+			find_token(first);
+		}
+
+		inline reference operator*() const { return token; }
+		inline pointer operator->() const { return &token; }
+
+		inline token_view_iterator& operator++()
+		{
+			find_token(token.data() + token.size());
+			return *this;
+		}
+
+		inline token_view_iterator operator++(int)
+		{
+			token_view_iterator itr(*this);
+			++(*this);
+			return itr;
+		}
+
+		inline bool operator==(token_view_iterator const& other) const { return token.data() == other.token.data(); }
+		inline bool operator!=(token_view_iterator const& other) const { return token.data() != other.token.data(); }
+
+	protected:
+		inline void find_token(Char const* pos)
+		{
+			Char const* first = detail::scan_token<false>(pos, itr_last);
+			Char const* last = detail::scan_token<true>(first, itr_last);
+
+			token = value_type(first, last - first);
+		}
+
+		value_type token;
+		Char const* itr_last;
+	};
+
+	/**
+	* Convert a token view to the parameter type. The strings are copied from the view, the views
+	* are passed through, the others go to token_cast without copying the token.
+	*/
+	template<typename Target, typename Char>
+	struct token_view_cast
+	{
+		static inline Target apply(std::basic_string_view<Char> const& token)
+		{
+			return token_cast<Target>(token.data(), token.data() + token.size());
+		}
+	};
+
+	template<typename Char>
+	struct token_view_cast<std::basic_string<Char>, Char>
+	{
+		static inline std::basic_string<Char> apply(std::basic_string_view<Char> const& token)
+		{
+			return std::basic_string<Char>(token);
+		}
+	};
+
+	template<typename Char>
+	struct token_view_cast<std::basic_string_view<Char>, Char>
+	{
+		static inline std::basic_string_view<Char> apply(std::basic_string_view<Char> const& token)
+		{
+			return token;
+		}
+	};
+
+	//the function name is always read as a narrow string
+	template<>
+	struct token_view_cast<std::string, wchar_t>
+	{
+		static inline std::string apply(std::wstring_view const& token)
+		{
+			return std::string(token.begin(), token.end());
+		}
+	};
+}
+
+#endif
@@ -0,0 +1,447 @@
+/**
+ * (C) Copyright 2013 Dreamer
+ *
+ * this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+* The bulk counterpart of fill_tuple and make_String. tuple_codec parses a whole buffer of
+* delimited records into a vector of tuples or into one vector per field, and serializes a batch
+* into one buffer. The numbers are parsed by token_cast and written by std::to_chars, every field
+* type is resolved at compile time by field_codec.
+*
+* A field can't contain the delimiters, there is no quoting.
+*/
+
+#ifndef _DT_TUPLE_CODEC_
+#define _DT_TUPLE_CODEC_
+
+#include <cstddef>
+#include <algorithm>
+#include <limits>
+#include <string>
+#include <tuple>
+#include <vector>
+#include <utility>
+#include <stdexcept>
+#include <type_traits>
+
+#include <boost/lexical_cast.hpp>
+
+#include "token_cast.hpp"
+
+namespace DT
+{
+	enum codec_errc
+	{
+		codec_invalid_field = 1,
+		codec_missing_field,
+		codec_extra_field
+	};
+
+	/** a field which isn't parsed, it keeps the default value */
+	struct codec_error
+	{
+		codec_errc code;
+
+		/** the zero based record index in the parsed batch */
+		size_t record;
+
+		/** the zero based field index, it is the field count for codec_extra_field */
+		size_t field;
+
+		/** the offset of the field from the buffer start, the record end for codec_missing_field */
+		size_t offset;
+	};
+
+	/**
+	* Parse and format one field of the type T. The generic one goes through lexical_cast,
+	* specialize it for the own field types.
+	*/
+	template<typename T, typename Char, typename Enable = void>
+	struct field_codec
+	{
+		static inline bool parse(Char const* first, Char const* last, T& value)
+		{
+			return try_token_cast(first, last, value);
+		}
+
+		static inline size_t max_size(T const& value)
+		{
+			return boost::lexical_cast< std::basic_string<Char> >(value).size();
+		}
+
+		static inline Char* format(T const& value, Char* pos)
+		{
+			std::basic_string<Char> strValue = boost::lexical_cast< std::basic_string<Char> >(value);
+			return std::copy(strValue.begin(), strValue.end(), pos);
+		}
+	};
+
+	template<typename Char, typename Traits, typename Alloc>
+	struct field_codec<std::basic_string<Char,Traits,Alloc>, Char>
+	{
+		static inline bool parse(Char const* first, Char const* last, std::basic_string<Char,Traits,Alloc>& value)
+		{
+			value.assign(first, last);
+			return true;
+		}
+
+		static inline size_t max_size(std::basic_string<Char,Traits,Alloc> const& value)
+		{
+			return value.size();
+		}
+
+		static inline Char* format(std::basic_string<Char,Traits,Alloc> const& value, Char* pos)
+		{
+			return std::copy(value.begin(), value.end(), pos);
+		}
+	};
+
+	//bool is written as 1 and 0 like lexical_cast
+	template<typename Char>
+	struct field_codec<bool, Char>
+	{
+		static inline bool parse(Char const* first, Char const* last, bool& value)
+		{
+			return try_token_cast(first, last, value);
+		}
+
+		static inline size_t max_size(bool)
+		{
+			return 1;
+		}
+
+		static inline Char* format(bool value, Char* pos)
+		{
+			*pos = value ? Char('1') : Char('0');
+			return pos + 1;
+		}
+	};
+
+#if defined(DT_TOKEN_CAST_FROM_CHARS)
+	// the numbers parsed by from_chars are written by to_chars, the wide text is widened from a stack buffer
+	template<typename T, typename Char>
+	struct field_codec<T, Char, typename std::enable_if<detail::is_from_chars_number<T>::value>::type>
+	{
+		// the sign, the digits, the decimal point and the exponent
+		static const size_t nMaxChars = std::is_integral<T>::value ? std::numeric_limits<T>::digits10 + 3 : std::numeric_limits<T>::max_digits10 + 10;
+
+		static inline bool parse(Char const* first, Char const* last, T& value)
+		{
+			return try_token_cast(first, last, value);
+		}
+
+		static inline size_t max_size(T)
+		{
+			return nMaxChars;
+		}
+
+		static inline Char* format(T value, Char* pos)
+		{
+			return format(value, pos, std::is_same<Char, char>());
+		}
+
+		static inline char* format(T value, char* pos, std::true_type)
+		{
+			return std::to_chars(pos, pos + nMaxChars, value).ptr;
+		}
+
+		static inline Char* format(T value, Char* pos, std::false_type)
+		{
+			char szBuf[nMaxChars];
+			char* pEnd = std::to_chars(szBuf, szBuf + nMaxChars, value).ptr;
+
+			return std::copy(szBuf, pEnd, pos);
+		}
+	};
+#endif
+
+	template<typename Record, typename Char = char>
+	class tuple_codec;
+
+	/**
+	* The codec of the records std::tuple<Fields...>. The fields are separated by field_delim and
+	* the records by record_delim, a "\r\n" line end is taken too if the record delimiter is '\n'.
+	* The empty records are skipped.
+	*/
+	template<typename... Fields, typename Char>
+	class tuple_codec<std::tuple<Fields...>, Char>
+	{
+		static_assert(sizeof...(Fields) > 0, "the record needs a field");
+
+	public:
+		typedef std::tuple<Fields...> record_type;
+
+		/** the column-wise storage, one vector per field */
+		typedef std::tuple< std::vector<Fields>... > columns_type;
+
+		static const size_t field_count = sizeof...(Fields);
+
+		explicit tuple_codec(Char fieldDelim = Char(';'), Char recordDelim = Char('\n'))
+			: field_delim(fieldDelim), record_delim(recordDelim)
+		{ }
+
+		/**
+		* Parse the records of [first, last) and append them to records. An invalid or missing
+		* field keeps its default value and is reported in errors, the record is still added.
+		*
+		* \return the number of the parsed records
+		*/
+		size_t parse(Char const* first, Char const* last, std::vector<record_type>& records, std::vector<codec_error>& errors) const
+		{
+			size_t nFirst = records.size();
+
+			parse_records(first, last, [&](Char const* pos, Char const* end, size_t nRecord) {
+				records.emplace_back();
+				parse_record(pos, end, first, nRecord, records.back(), errors, std::index_sequence_for<Fields...>());
+			});
+
+			return records.size() - nFirst;
+		}
+
+		/** parse the records into the columns, see parse() */
+		size_t parse(Char const* first, Char const* last, columns_type& columns, std::vector<codec_error>& errors) const
+		{
+			return parse_records(first, last, [&](Char const* pos, Char const* end, size_t nRecord) {
+				record_type record;
+				parse_record(pos, end, first, nRecord, record, errors, std::index_sequence_for<Fields...>());
+				append_columns(columns, std::move(record), std::index_sequence_for<Fields...>());
+			});
+		}
+
+		inline size_t parse(std::basic_string<Char> const& text, std::vector<record_type>& records, std::vector<codec_error>& errors) const
+		{
+			return parse(text.data(), text.data() + text.size(), records, errors);
+		}
+
+		inline size_t parse(std::basic_string<Char> const& text, columns_type& columns, std::vector<codec_error>& errors) const
+		{
+			return parse(text.data(), text.data() + text.size(), columns, errors);
+		}
+
+		/** the buffer size serialize() needs at most for the records */
+		size_t max_size(std::vector<record_type> const& records) const
+		{
+			size_t nSize = 0;
+
+			for(size_t i = 0; i < records.size(); i++)
+				nSize += record_size(records[i], std::index_sequence_for<Fields...>());
+
+			return nSize;
+		}
+
+		/** \throw std::runtime_error if the columns have different sizes */
+		size_t max_size(columns_type const& columns) const
+		{
+			size_t nSize = 0, nRecords = column_rows(columns);
+
+			for(size_t i = 0; i < nRecords; i++)
+				nSize += column_record_size(columns, i, std::index_sequence_for<Fields...>());
+
+			return nSize;
+		}
+
+		/**
+		* Write the records to the buffer, every record ends with the record delimiter. The buffer
+		* must have max_size() characters.
+		*
+		* \return the end of the written text
+		*/
+		Char* serialize(std::vector<record_type> const& records, Char* buffer) const
+		{
+			for(size_t i = 0; i < records.size(); i++)
+				buffer = format_record(records[i], buffer, std::index_sequence_for<Fields...>());
+
+			return buffer;
+		}
+
+		/** \throw std::runtime_error if the columns have different sizes */
+		Char* serialize(columns_type const& columns, Char* buffer) const
+		{
+			size_t nRecords = column_rows(columns);
+
+			for(size_t i = 0; i < nRecords; i++)
+				buffer = format_column_record(columns, i, buffer, std::index_sequence_for<Fields...>());
+
+			return buffer;
+		}
+
+		/** append the records to the text, it is allocated once */
+		template<typename Batch>
+		void serialize(Batch const& batch, std::basic_string<Char>& text) const
+		{
+			size_t nStart = text.size();
+
+			text.resize(nStart + max_size(batch));
+			Char* pEnd = serialize(batch, &text[0] + nStart);
+			text.resize(pEnd - text.data());
+		}
+
+	protected:
+		template<typename RecordSink>
+		size_t parse_records(Char const* first, Char const* last, RecordSink sink) const
+		{
+			typedef std::char_traits<Char> traits;
+			size_t nRecords = 0;
+			Char const* pos = first;
+
+			while(pos != last)
+			{
+				Char const* pEnd = traits::find(pos, last - pos, record_delim);
+				if(pEnd == NULL)
+					pEnd = last;
+
+				Char const* pLineEnd = pEnd;
+				if(record_delim == Char('\n') && pLineEnd != pos && *(pLineEnd - 1) == Char('\r'))
+					--pLineEnd;
+
+				if(pLineEnd != pos)
+					sink(pos, pLineEnd, nRecords++);
+
+				pos = (pEnd == last) ? last : pEnd + 1;
+			}
+
+			return nRecords;
+		}
+
+		// the fields of a record are read in order, bMore is false after the last field
+		struct field_cursor
+		{
+			Char const* pos;
+			Char const* end;
+			bool bMore;
+		};
+
+		template<size_t... Is>
+		void parse_record(Char const* pos, Char const* end, Char const* base, size_t nRecord, record_type& record, std::vector<codec_error>& errors, std::index_sequence<Is...>) const
+		{
+			field_cursor cursor = {pos, end, true};
+			int dummy[] = {0, (parse_field<Is>(cursor, base, nRecord, std::get<Is>(record), errors), 0)...};
+			(void)dummy;
+
+			if(cursor.bMore)
+			{
+				codec_error err = {codec_extra_field, nRecord, field_count, (size_t)(cursor.pos - base)};
+				errors.push_back(err);
+			}
+		}
+
+		template<size_t I, typename T>
+		inline void parse_field(field_cursor& cursor, Char const* base, size_t nRecord, T& value, std::vector<codec_error>& errors) const
+		{
+			if(!cursor.bMore)
+			{
+				codec_error err = {codec_missing_field, nRecord, I, (size_t)(cursor.end - base)};
+				errors.push_back(err);
+				return;
+			}
+
+			Char const* pEnd = std::char_traits<Char>::find(cursor.pos, cursor.end - cursor.pos, field_delim);
+			if(pEnd == NULL)
+				pEnd = cursor.end;
+
+			if(!field_codec<T, Char>::parse(cursor.pos, pEnd, value))
+			{
+				value = T();
+
+				codec_error err = {codec_invalid_field, nRecord, I, (size_t)(cursor.pos - base)};
+				errors.push_back(err);
+			}
+
+			if(pEnd == cursor.end)
+				cursor.bMore = false;
+			else
+				cursor.pos = pEnd + 1;
+		}
+
+		template<size_t... Is>
+		static inline void append_columns(columns_type& columns, record_type&& record, std::index_sequence<Is...>)
+		{
+			int dummy[] = {0, (std::get<Is>(columns).push_back(std::move(std::get<Is>(record))), 0)...};
+			(void)dummy;
+		}
+
+		template<size_t... Is>
+		static inline size_t record_size(record_type const& record, std::index_sequence<Is...>)
+		{
+			size_t nSize = field_count;
+			int dummy[] = {0, (nSize += field_codec<Fields, Char>::max_size(std::get<Is>(record)), 0)...};
+			(void)dummy;
+
+			return nSize;
+		}
+
+		template<size_t... Is>
+		static inline size_t column_record_size(columns_type const& columns, size_t nRow, std::index_sequence<Is...>)
+		{
+			size_t nSize = field_count;
+			int dummy[] = {0, (nSize += field_codec<Fields, Char>::max_size(std::get<Is>(columns)[nRow]), 0)...};
+			(void)dummy;
+
+			return nSize;
+		}
+
+		template<size_t... Is>
+		inline Char* format_record(record_type const& record, Char* pos, std::index_sequence<Is...>) const
+		{
+			int dummy[] = {0, (pos = format_field<Fields>(std::get<Is>(record), pos, Is + 1 == field_count ? record_delim : field_delim), 0)...};
+			(void)dummy;
+
+			return pos;
+		}
+
+		template<size_t... Is>
+		inline Char* format_column_record(columns_type const& columns, size_t nRow, Char* pos, std::index_sequence<Is...>) const
+		{
+			int dummy[] = {0, (pos = format_field<Fields>(std::get<Is>(columns)[nRow], pos, Is + 1 == field_count ? record_delim : field_delim), 0)...};
+			(void)dummy;
+
+			return pos;
+		}
+
+		template<typename T>
+		static inline Char* format_field(T const& value, Char* pos, Char delim)
+		{
+			pos = field_codec<T, Char>::format(value, pos);
+			*pos = delim;
+
+			return pos + 1;
+		}
+
+		static size_t column_rows(columns_type const& columns)
+		{
+			size_t nRows = std::get<0>(columns).size();
+
+			if(!same_rows(columns, nRows, std::index_sequence_for<Fields...>()))
+				throw std::runtime_error("the columns have different sizes");
+
+			return nRows;
+		}
+
+		template<size_t... Is>
+		static inline bool same_rows(columns_type const& columns, size_t nRows, std::index_sequence<Is...>)
+		{
+			bool bSame = true;
+			int dummy[] = {0, (bSame = bSame && std::get<Is>(columns).size() == nRows, 0)...};
+			(void)dummy;
+
+			return bSame;
+		}
+
+		Char field_delim;
+		Char record_delim;
+	};
+}
+
+#endif
@@ -0,0 +1,216 @@
+/**
+ * (C) Copyright 2013 Dreamer
+ *
+ * this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _DT_WORK_STEALING_POOL_
+#define _DT_WORK_STEALING_POOL_
+
+#include <deque>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <condition_variable>
+
+namespace DT
+{
+	/**
+	* A fixed size thread pool. Every worker owns a task queue and takes the tasks from the front
+	* of it. When its own queue is empty, the worker steals from the back of the other queues, so
+	* the uneven tasks of a batch still keep all the workers busy.
+	*
+	* Don't call parallel_for() from a task of the same pool, the worker would wait for itself.
+	*/
+	class work_stealing_pool
+	{
+	public:
+		typedef std::function<void ()> task;
+
+		explicit work_stealing_pool(size_t nThreads = std::thread::hardware_concurrency())
+			: nQueued(0), nNextQueue(0), bStop(false)
+		{
+			if(nThreads == 0)
+				nThreads = 1;
+
+			for(size_t i = 0; i < nThreads; i++)
+				queues.push_back(std::unique_ptr<worker_queue>(new worker_queue()));
+
+			for(size_t i = 0; i < nThreads; i++)
+				threads.push_back(std::thread(&work_stealing_pool::run, this, i));
+		}
+
+		~work_stealing_pool()
+		{
+			{
+				std::lock_guard<std::mutex> guard(wake_lock);
+				bStop = true;
+			}
+
+			wake.notify_all();
+
+			for(size_t i = 0; i < threads.size(); i++)
+				threads[i].join();
+		}
+
+		inline size_t size() const
+		{
+			return threads.size();
+		}
+
+		/** queue the task, the queues are filled round robin */
+		void submit(task const& t)
+		{
+			worker_queue& queue = *queues[nNextQueue.fetch_add(1, std::memory_order_relaxed) % queues.size()];
+
+			{
+				std::lock_guard<std::mutex> guard(queue.lock);
+				queue.tasks.push_back(t);
+			}
+
+			{
+				std::lock_guard<std::mutex> guard(wake_lock);
+				nQueued++;
+			}
+
+			wake.notify_one();
+		}
+
+		/**
+		* Run fn(i) for every i in [0, nCount) and wait for all of them. The range is split into 
+		* a few chunks per worker.
+		*
+		* \throw the first exception thrown by fn, the other chunks still run to the end
+		*/
+		template<typename Function>
+		void parallel_for(size_t nCount, Function const& fn)
+		{
+			if(nCount == 0)
+				return;
+
+			size_t nChunk = nCount / (threads.size() * 4);
+			if(nChunk == 0)
+				nChunk = 1;
+
+			std::mutex done_lock;
+			std::condition_variable done;
+			std::exception_ptr error;
+			size_t nLeft = (nCount + nChunk - 1) / nChunk;
+
+			for(size_t nFirst = 0; nFirst < nCount; nFirst += nChunk)
+			{
+				size_t nLast = (nFirst + nChunk < nCount) ? nFirst + nChunk : nCount;
+
+				submit([&, nFirst, nLast]() {
+					std::exception_ptr chunk_error;
+
+					try
+					{
+						for(size_t i = nFirst; i < nLast; i++)
+							fn(i);
+					}
+					catch(...)
+					{
+						chunk_error = std::current_exception();
+					}
+
+					std::lock_guard<std::mutex> guard(done_lock);
+
+					if(chunk_error && !error)
+						error = chunk_error;
+
+					if(--nLeft == 0)
+						done.notify_all();
+				});
+			}
+
+			std::unique_lock<std::mutex> guard(done_lock);
+			done.wait(guard, [&]() { return nLeft == 0; });
+
+			if(error)
+				std::rethrow_exception(error);
+		}
+
+	protected:
+		struct worker_queue
+		{
+			std::mutex lock;
+			std::deque<task> tasks;
+		};
+
+		// take the task from the front of the own queue, otherwise steal from the back of the others
+		bool pop_task(size_t nIndex, task& t)
+		{
+			for(size_t n = 0; n < queues.size(); n++)
+			{
+				worker_queue& queue = *queues[(nIndex + n) % queues.size()];
+				std::lock_guard<std::mutex> guard(queue.lock);
+
+				if(queue.tasks.empty())
+					continue;
+
+				if(n == 0)
+				{
+					t.swap(queue.tasks.front());
+					queue.tasks.pop_front();
+				}
+				else
+				{
+					t.swap(queue.tasks.back());
+					queue.tasks.pop_back();
+				}
+
+				nQueued--;
+				return true;
+			}
+
+			return false;
+		}
+
+		void run(size_t nIndex)
+		{
+			task t;
+
+			while(true)
+			{
+				if(pop_task(nIndex, t))
+				{
+					t();
+					t = task();
+					continue;
+				}
+
+				std::unique_lock<std::mutex> guard(wake_lock);
+				wake.wait(guard, [this]() { return bStop || nQueued > 0; });
+
+				if(bStop && nQueued == 0)
+					return;
+			}
+		}
+
+		std::vector< std::unique_ptr<worker_queue> > queues;
+		std::vector<std::thread> threads;
+
+		std::mutex wake_lock;
+		std::condition_variable wake;
+		std::atomic<size_t> nQueued;
+		std::atomic<size_t> nNextQueue;
+		bool bStop;
+	};
+}
+
+#endif